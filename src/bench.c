@@ -0,0 +1,607 @@
+/*** feature test macros for code portability ***/
+#define _DEFAULT_SOURCE
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/resource.h>
+
+#include "constants.h"
+#include "enums.h"
+#include "main.h"
+#include "editor.h"
+#include "row.h"
+#include "fileio.h"
+#include "input.h"
+#include "output.h"
+#include "terminal.h"
+#include "vterm.h"
+#include "highlight.h"
+#include "follow.h"
+#include "cold.h"
+#include "intern.h"
+#include "hlcache.h"
+#include "diff.h"
+#include "memory.h"
+#include "find.h"
+#include "words.h"
+
+// headless benchmark harness: drives the editor core through the
+// virtual terminal and prints one JSON record per (file size, workload)
+//
+//   usage: editor-bench [lines ...]
+
+struct editorConfig E;
+
+// time budget (ns) and op cap for every workload, at least one op always runs
+#define BENCH_BUDGET_NS 500000000LL
+#define BENCH_MAX_OPS 2000
+
+#define BENCH_MARKER "wasm_bench_marker"
+
+/*** allocation counting (linked with -Wl,--wrap=malloc etc.) ***/
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static size_t allocs;
+
+void *__wrap_malloc(size_t size) {
+	allocs++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+	allocs++;
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	allocs++;
+	return __real_realloc(ptr, size);
+}
+
+/*** helpers ***/
+
+static long long nowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long peakRssKb() {
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+}
+
+static void benchDie(const char *s) {
+	perror(s);
+	exit(1);
+}
+
+// write a C-looking file of the given number of lines, ending with a
+// line that holds BENCH_MARKER so the find workload walks the whole file
+static void benchGenerate(const char *path, size_t lines) {
+	static const char *templates[] = {
+		"int function_%zu(int a, int b) {",
+		"\tint x = a + b * %zu;",
+		"\t/* compute the next value */",
+		"\tif (x > 100) return x; // early out",
+		"\tchar *s = \"string literal %zu\";",
+		"\treturn x - 0.5;",
+		"}",
+		"",
+	};
+	size_t ntemplates = sizeof(templates) / sizeof(templates[0]);
+
+	FILE *fp = fopen(path, "w");
+	if (!fp) benchDie("fopen");
+	for (size_t i = 0; i + 1 < lines; i++) {
+		fprintf(fp, templates[i % ntemplates], i);
+		fputc('\n', fp);
+	}
+	fprintf(fp, "// %s\n", BENCH_MARKER);
+	if (fclose(fp) == EOF) benchDie("fclose");
+}
+
+// the same as benchGenerate with some non-ASCII text (accents, CJK,
+// emoji) on every other line
+static void benchGenerateUtf8(const char *path, size_t lines) {
+	static const char *templates[] = {
+		"int función_%zu(int a, int b) {",
+		"\tint x = a + b * %zu;",
+		"\t/* calcule la valeur suivante, 次の値 */",
+		"\tif (x > 100) return x; // early out",
+		"\tchar *s = \"chaîne %zu 🙂\";",
+		"\treturn x - 0.5;",
+		"}",
+		"// größe",
+	};
+	size_t ntemplates = sizeof(templates) / sizeof(templates[0]);
+
+	FILE *fp = fopen(path, "w");
+	if (!fp) benchDie("fopen");
+	for (size_t i = 0; i < lines; i++) {
+		fprintf(fp, templates[i % ntemplates], i);
+		fputc('\n', fp);
+	}
+	if (fclose(fp) == EOF) benchDie("fclose");
+}
+
+// write a single line of minified JSON of about the given number of bytes
+static void benchGenerateLong(const char *path, size_t bytes) {
+	FILE *fp = fopen(path, "w");
+	if (!fp) benchDie("fopen");
+	size_t n = 1;
+	fputc('[', fp);
+	for (size_t i = 0; n < bytes; i++)
+		n += fprintf(fp, "{\"id\": %zu, \"v\": [1, 2.5, \"x\"]}, ", i);
+	fprintf(fp, "{}]\n");
+	if (fclose(fp) == EOF) benchDie("fclose");
+}
+
+static void benchInitEditor() {
+	int rows, cols;
+	if (getWindowSize(&rows, &cols) == -1) benchDie("getWindowSize");
+	editorInit(&E, rows - 2, cols);
+}
+
+/*** workloads ***/
+
+struct benchResult {
+	size_t ops;
+	long long ns;
+	size_t allocs;
+	size_t bytes;
+	size_t frames;
+	size_t lexed; // bytes run through a lexer, for lex_* workloads
+	size_t live; // bytes the editor holds after the last op
+	size_t lookups, hits; // highlight cache, see hlcache.h
+};
+
+// one keystroke as the main loop sees it: process the key, then repaint
+static void benchKey(int key) {
+	vtermPushKey(key);
+	editorProcessKeypress();
+	editorRefreshScreen();
+}
+
+static void benchKeys(const char *s) {
+	while (*s) benchKey((unsigned char)*s++);
+}
+
+static void benchMoveTo(size_t cy, size_t cx) {
+	E.cy = cy < E.numrows ? cy : E.numrows;
+	E.cx = 0;
+	if (E.cy < E.numrows && cx <= E.row[E.cy].size) E.cx = cx;
+}
+
+static const char *bench_path;
+static size_t bench_lines;
+
+static void opOpen() {
+	editorFree(&E);
+	if (editorOpen(&E, (char *)bench_path) == -1) benchDie("editorOpen");
+	editorRefreshScreen();
+}
+
+// time to the first frame of a progressive open (from an empty editor,
+// see setupEmpty), the rest of the file is dropped with the next workload
+static void opFirstPaint() {
+	if (editorOpenProgressive(&E, (char *)bench_path) == -1) benchDie("editorOpenProgressive");
+	editorRefreshScreen();
+}
+
+// open the file in follow mode and run the main loop's side of it until
+// every line is in
+static void opFollow() {
+	editorFree(&E);
+	if (editorOpenFollow(&E, (char *)bench_path) == -1) benchDie("editorOpenFollow");
+	while (E.numrows < bench_lines) {
+		struct pollfd pfd = { .fd = editorFollowFd(&E), .events = POLLIN };
+		if (!editorFollowPending(&E)) poll(&pfd, 1, -1);
+		if (editorFollowService(&E)) editorRefreshScreen();
+	}
+	editorFollowStop(&E);
+}
+
+static void opType() {
+	benchKeys("x");
+}
+
+static void opPaste() {
+	benchKeys("\tint pasted = 42; /* a pasted line */\r"
+		"\tchar *p = \"pasted string\";\r"
+		"\tif (pasted) return pasted; // comment\r");
+}
+
+// a block comment pasted at the top. Typed a key at a time, its opening
+// re-highlights every row below and its close does it again
+#define BENCH_PASTE_COMMENT "/* pasted\r * block comment\r */\r"
+
+static void opPasteComment() {
+	benchMoveTo(0, 0);
+	benchKeys(BENCH_PASTE_COMMENT);
+}
+
+// the same paste as one edit (see editorBeginEdit): the rows below end up
+// in the state they were in, so they're left alone
+static void opPasteEdit() {
+	benchMoveTo(0, 0);
+	editorBeginEdit(&E);
+	for (const char *s = BENCH_PASTE_COMMENT; *s; s++) {
+		if (*s == '\r') editorInsertNewline(&E);
+		else editorInsertChar(&E, *s);
+	}
+	editorCommitEdit(&E);
+	editorRefreshScreen();
+}
+
+// open a brace at the top and jump to the one closing it at the end
+// (see setupBrackets), then take it out again
+static void opBracketJump() {
+	benchMoveTo(0, 0);
+	benchKeys("{");
+	benchMoveTo(0, 0);
+	benchKey(CTRL_KEY('p'));
+	benchMoveTo(0, 1);
+	benchKey(BACKSPACE);
+}
+
+// a screen down with soft wrap on (see setupWrap)
+static void opWrapPage() {
+	benchKey(PAGE_DOWN);
+}
+
+// the window narrows to half its width or widens back, only the rows
+// drawn are wrapped again
+static void opWrapResize() {
+	static int half;
+	half = !half;
+	E.screencols = half ? E.screencols / 2 : E.screencols * 2;
+	editorRefreshScreen();
+}
+
+static void opEnterTop() {
+	benchMoveTo(0, 0);
+	benchKey('\r');
+}
+
+static void opCommentToggle() {
+	// opening a block comment at the top re-highlights every row below it
+	benchMoveTo(0, 0);
+	benchKeys("/*");
+	benchKey(BACKSPACE);
+	benchKey(BACKSPACE);
+}
+
+// pick the syntax again, as a save as does: every row is highlighted
+// again from the same text
+static void opReselectSyntax() {
+	editorSelectSyntaxHighlight(&E);
+}
+
+static void opFind() {
+	benchMoveTo(0, 0);
+	vtermPushKey(CTRL_KEY('f'));
+	vtermPushKeys(BENCH_MARKER "\r");
+	editorProcessKeypress();
+	editorRefreshScreen();
+}
+
+static void opRedraw() {
+	editorRefreshScreen();
+}
+
+static void opSave() {
+	// always the whole file, as if it changed on disk
+	E.save.exact = 0;
+	benchKey(CTRL_KEY('s'));
+}
+
+// overwrite a byte in the middle row, the file keeps its size
+static void opSaveInPlace() {
+	benchMoveTo(E.numrows / 2, 0);
+	benchKey(DEL_KEY);
+	benchKeys("x");
+	benchKey(CTRL_KEY('s'));
+}
+
+// grow the middle row, everything after it moves
+static void opSaveTail() {
+	benchMoveTo(E.numrows / 2, 0);
+	benchKeys("x");
+	benchKey(CTRL_KEY('s'));
+}
+
+// jump around the file by byte offset, pseudo-randomly but repeatably
+static void opGotoByte() {
+	static size_t seed = 1;
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	editorGotoOffset(&E, (seed >> 17) % (editorRowOffset(&E, E.numrows) + 1));
+	editorRefreshScreen();
+}
+
+// another process appends a line, as to a log, and the editor reloads
+static void opReloadAppend() {
+	FILE *fp = fopen(bench_path, "a");
+	if (!fp) benchDie("fopen");
+	fprintf(fp, "// appended line\n");
+	if (fclose(fp) == EOF) benchDie("fclose");
+	if (editorReload(&E) == -1) benchDie("editorReload");
+	editorRefreshScreen();
+}
+
+static size_t lexed;
+
+// lex every row of the file into a scratch buffer
+static void benchLexAll(int (*lex)(struct editorSyntax *, erow *, int, unsigned char *)) {
+	static unsigned char *hl;
+	static size_t hlcap;
+	int state = 0;
+	for (size_t i = 0; i < E.numrows; i++) {
+		erow *row = &E.row[i];
+		if (row->rsize > hlcap) {
+			hlcap = row->rsize * 2;
+			hl = realloc(hl, hlcap);
+		}
+		state = lex(E.syntax, row, state, hl);
+		lexed += row->rsize;
+	}
+}
+
+static void opLexLegacy() {
+	benchLexAll(editorLexRowLegacy);
+}
+
+static void opLexTable() {
+	benchLexAll(editorLexRow);
+}
+
+// a short word on most lines for a longer one, then repaint
+static void opReplaceAll() {
+	editorReplaceAll(&E, "int", "long");
+	editorRefreshScreen();
+}
+
+// freeze every row far from the view, as the main loop does while idle
+static void opColdSweep() {
+	while (editorColdSweep(&E));
+}
+
+// share every repeated line, as the main loop does while idle
+static void opInternSweep() {
+	while (editorInternSweep(&E));
+}
+
+// index every word of the file, as the main loop does while idle
+static void opWordsSweep() {
+	while (editorWordsSweep(&E));
+}
+
+// the diff gutter from nothing: hash every row, read the file and diff
+static void opDiffOpen() {
+	editorDiffFree(&E);
+	editorDiffToggle(&E);
+	editorDiffFlush(&E);
+}
+
+// a key typed with the gutter on, and the diff it takes to mark it
+static void opDiffType() {
+	benchKeys("x");
+	editorDiffFlush(&E);
+}
+
+// what Ctrl-N asks the identifier index for
+static void opComplete() {
+	const char *words[EDITOR_COMPLETE_MAX];
+	size_t lens[EDITOR_COMPLETE_MAX];
+	editorWordsComplete(&E, "function_12", 11, words, lens, EDITOR_COMPLETE_MAX);
+}
+
+static struct benchResult benchRun(void (*setup)(), void (*op)(), size_t max_ops) {
+	struct benchResult r = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	if (setup) setup();
+	vtermResetCounters();
+	lexed = 0;
+	size_t allocs_start = allocs;
+	size_t lookups_start = E.hlcache.lookups, hits_start = E.hlcache.hits;
+	long long start = nowNs();
+	do {
+		op();
+		r.ops++;
+		r.ns = nowNs() - start;
+	} while (r.ops < max_ops && r.ns < BENCH_BUDGET_NS);
+	r.allocs = allocs - allocs_start;
+	r.bytes = vtermBytesWritten();
+	r.frames = vtermFramesWritten();
+	r.lexed = lexed;
+	r.live = memLive(MEM_COUNT);
+	r.lookups = E.hlcache.lookups - lookups_start;
+	r.hits = E.hlcache.hits - hits_start;
+	return r;
+}
+
+// every workload starts from a freshly opened copy of the file
+static void setupEmpty() {
+	editorFree(&E);
+	// hand the freed rows back now, not in the middle of the next op
+	malloc_trim(0);
+}
+
+static void setupTop() {
+	opOpen();
+}
+
+static void setupMiddle() {
+	opOpen();
+	benchMoveTo(E.numrows / 2, 4);
+}
+
+static void setupWords() {
+	opOpen();
+	opWordsSweep();
+}
+
+static void setupBrackets() {
+	opOpen();
+	benchMoveTo(E.numrows, 0);
+	benchKeys("}");
+}
+
+static void setupWrap() {
+	opOpen();
+	benchKey(CTRL_KEY('w'));
+	benchMoveTo(E.numrows / 2, 0);
+}
+
+static void setupIntern() {
+	opOpen();
+	editorInternStart(&E);
+}
+
+static void setupInternMiddle() {
+	setupIntern();
+	opInternSweep();
+	benchMoveTo(E.numrows / 2, 4);
+}
+
+static void setupDiffMiddle() {
+	setupMiddle();
+	opDiffOpen();
+}
+
+// a session cache left where setupMiddle leaves the view, for opOpen to
+// reopen from (files under EDITOR_SESSION_MIN_SIZE don't get one)
+static void setupSession() {
+	setupMiddle();
+	editorSessionSave(&E);
+}
+
+static void benchDropSession() {
+	char path[80];
+	snprintf(path, sizeof(path), "%s.session", bench_path);
+	unlink(path);
+}
+
+static void setupCold() {
+	opOpen();
+	opColdSweep();
+}
+
+static void setupLongMiddle() {
+	opOpen();
+	benchMoveTo(0, E.numrows ? E.row[0].size / 2 : 0);
+}
+
+static int first_record = 1;
+
+static void benchReport(size_t lines, const char *name, struct benchResult r) {
+	printf("%s\n    {\"lines\": %zu, \"workload\": \"%s\", \"ops\": %zu, "
+		"\"ns_per_op\": %.0f, \"allocs_per_op\": %.1f, \"peak_rss_kb\": %ld, "
+		"\"bytes_per_frame\": %.0f, \"live_bytes\": %zu",
+		first_record ? "" : ",", lines, name, r.ops,
+		(double)r.ns / r.ops, (double)r.allocs / r.ops, peakRssKb(),
+		r.frames ? (double)r.bytes / r.frames : 0.0, r.live);
+	if (r.lexed) printf(", \"lex_bytes_per_sec\": %.0f", r.lexed * 1e9 / r.ns);
+	if (r.lookups) printf(", \"hl_cache_hit_rate\": %.3f", (double)r.hits / r.lookups);
+	printf("}");
+	first_record = 0;
+	fflush(stdout);
+}
+
+static void benchFile(size_t lines) {
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/wasm-editor-bench-%d-%zu.c", (int)getpid(), lines);
+	benchGenerate(path, lines);
+	bench_path = path;
+	bench_lines = lines;
+
+	benchReport(lines, "open", benchRun(NULL, opOpen, 1));
+	benchReport(lines, "first_paint", benchRun(setupEmpty, opFirstPaint, 1));
+	benchReport(lines, "follow", benchRun(NULL, opFollow, 1));
+	benchReport(lines, "type", benchRun(setupMiddle, opType, BENCH_MAX_OPS));
+	benchReport(lines, "paste", benchRun(setupMiddle, opPaste, BENCH_MAX_OPS));
+	benchReport(lines, "paste_comment", benchRun(setupTop, opPasteComment, BENCH_MAX_OPS));
+	benchReport(lines, "paste_edit", benchRun(setupTop, opPasteEdit, BENCH_MAX_OPS));
+	benchReport(lines, "bracket_jump", benchRun(setupBrackets, opBracketJump, BENCH_MAX_OPS));
+	benchReport(lines, "wrap_page", benchRun(setupWrap, opWrapPage, BENCH_MAX_OPS));
+	benchReport(lines, "wrap_resize", benchRun(setupWrap, opWrapResize, BENCH_MAX_OPS));
+	benchReport(lines, "enter_top", benchRun(setupTop, opEnterTop, BENCH_MAX_OPS));
+	benchReport(lines, "comment_toggle", benchRun(setupTop, opCommentToggle, BENCH_MAX_OPS));
+	benchReport(lines, "reselect_syntax", benchRun(setupTop, opReselectSyntax, BENCH_MAX_OPS));
+	benchReport(lines, "find", benchRun(setupTop, opFind, BENCH_MAX_OPS));
+	benchReport(lines, "redraw", benchRun(setupMiddle, opRedraw, BENCH_MAX_OPS));
+	benchReport(lines, "save", benchRun(setupMiddle, opSave, BENCH_MAX_OPS));
+	benchReport(lines, "save_inplace", benchRun(setupTop, opSaveInPlace, BENCH_MAX_OPS));
+	benchReport(lines, "save_tail", benchRun(setupTop, opSaveTail, BENCH_MAX_OPS));
+	benchReport(lines, "goto_byte", benchRun(setupTop, opGotoByte, BENCH_MAX_OPS));
+	benchReport(lines, "lex_legacy", benchRun(setupTop, opLexLegacy, BENCH_MAX_OPS));
+	benchReport(lines, "lex_table", benchRun(setupTop, opLexTable, BENCH_MAX_OPS));
+	benchReport(lines, "replace_all", benchRun(setupTop, opReplaceAll, 1));
+	benchReport(lines, "words_sweep", benchRun(setupTop, opWordsSweep, 1));
+	benchReport(lines, "complete", benchRun(setupWords, opComplete, BENCH_MAX_OPS));
+	benchReport(lines, "intern_sweep", benchRun(setupIntern, opInternSweep, 1));
+	benchReport(lines, "intern_type", benchRun(setupInternMiddle, opType, BENCH_MAX_OPS));
+	benchReport(lines, "intern_paste", benchRun(setupInternMiddle, opPaste, BENCH_MAX_OPS));
+	benchReport(lines, "diff_open", benchRun(setupTop, opDiffOpen, BENCH_MAX_OPS));
+	benchReport(lines, "diff_type", benchRun(setupDiffMiddle, opDiffType, BENCH_MAX_OPS));
+	benchReport(lines, "cold_sweep", benchRun(setupTop, opColdSweep, 1));
+	benchReport(lines, "cold_goto_byte", benchRun(setupCold, opGotoByte, BENCH_MAX_OPS));
+	benchReport(lines, "cold_find", benchRun(setupCold, opFind, BENCH_MAX_OPS));
+	benchReport(lines, "cold_save", benchRun(setupCold, opSave, BENCH_MAX_OPS));
+	benchReport(lines, "session_open", benchRun(setupSession, opOpen, BENCH_MAX_OPS));
+	benchReport(lines, "session_redraw", benchRun(NULL, opRedraw, BENCH_MAX_OPS));
+	benchDropSession();
+	// last, it grows the file
+	benchReport(lines, "reload_append", benchRun(setupTop, opReloadAppend, BENCH_MAX_OPS));
+
+	// the same amount of text on one line, see longrow.h
+	char long_path[64];
+	snprintf(long_path, sizeof(long_path), "/tmp/wasm-editor-bench-%d-%zu.json", (int)getpid(), lines);
+	benchGenerateLong(long_path, lines * 32);
+	bench_path = long_path;
+
+	benchReport(lines, "long_open", benchRun(NULL, opOpen, 1));
+	benchReport(lines, "long_type", benchRun(setupLongMiddle, opType, BENCH_MAX_OPS));
+	benchReport(lines, "long_redraw", benchRun(setupLongMiddle, opRedraw, BENCH_MAX_OPS));
+
+	// the same file with UTF-8 in it, see utf8.h
+	char utf8_path[64];
+	snprintf(utf8_path, sizeof(utf8_path), "/tmp/wasm-editor-bench-%d-%zu-utf8.c", (int)getpid(), lines);
+	benchGenerateUtf8(utf8_path, lines);
+	bench_path = utf8_path;
+
+	benchReport(lines, "utf8_open", benchRun(NULL, opOpen, 1));
+	benchReport(lines, "utf8_type", benchRun(setupMiddle, opType, BENCH_MAX_OPS));
+	benchReport(lines, "utf8_redraw", benchRun(setupMiddle, opRedraw, BENCH_MAX_OPS));
+
+	editorFree(&E);
+	unlink(path);
+	unlink(long_path);
+	unlink(utf8_path);
+}
+
+int main(int argc, char *argv[]) {
+	static const size_t default_lines[] = { 1000, 10000, 100000, 1000000, 10000000 };
+
+	vtermEnable(24, 80);
+	benchInitEditor();
+
+	printf("{\"benchmarks\": [");
+	if (argc >= 2) {
+		for (int i = 1; i < argc; i++) benchFile(strtoull(argv[i], NULL, 10));
+	} else {
+		for (size_t i = 0; i < sizeof(default_lines) / sizeof(default_lines[0]); i++)
+			benchFile(default_lines[i]);
+	}
+	printf("\n]}\n");
+	return 0;
+}
@@ -0,0 +1,192 @@
+#include <string.h>
+#include <sys/types.h>
+#include "enums.h"
+#include "structs.h"
+#include "brackets.h"
+#include "row.h"
+#include "cold.h"
+#include "memory.h"
+
+static const struct bracketSummary brackets_none = { 0, 0, 0 };
+
+// 1 for an opening bracket at render[i], -1 for a closing one, 0 else
+static int bracketAt(erow *row, size_t i) {
+	if (row->hl[i] == HL_STRING || row->hl[i] == HL_COMMENT || row->hl[i] == HL_MLCOMMENT)
+		return 0;
+	switch (row->render[i]) {
+		case '(': case '[': case '{': return 1;
+		case ')': case ']': case '}': return -1;
+		default: return 0;
+	}
+}
+
+// a run of rows followed by the next one
+static struct bracketSummary bracketsCombine(struct bracketSummary a, struct bracketSummary b) {
+	struct bracketSummary s;
+	s.delta = a.delta + b.delta;
+	s.min = a.min < a.delta + b.min ? a.min : a.delta + b.min;
+	s.max = b.max > b.delta + a.max ? b.max : b.delta + a.max;
+	return s;
+}
+
+void editorBracketsRow(erow *row) {
+	struct bracketSummary s = brackets_none;
+	if (row->chunks == NULL && row->hl) {
+		for (size_t i = 0; i < row->rsize; i++) {
+			int d = bracketAt(row, i);
+			if (d == 0) continue;
+			s.delta += d;
+			if (s.delta < s.min) s.min = s.delta;
+		}
+		// the most a tail opens is what the row opens past its lowest point
+		s.max = s.delta - s.min;
+	}
+	row->brackets = s;
+}
+
+/*** the tree ***/
+
+static void bracketsPull(struct editorBrackets *b, size_t i) {
+	b->t[i] = bracketsCombine(b->t[2 * i], b->t[2 * i + 1]);
+}
+
+// bring the nodes above the leaves that changed up to date
+static void bracketsRefresh(struct editorBrackets *b) {
+	size_t lo = b->valid, hi = b->top > b->n ? b->top : b->n;
+	if (lo < hi) {
+		for (lo = (lo + b->cap) / 2, hi = (hi - 1 + b->cap) / 2; lo > 0; lo /= 2, hi /= 2)
+			for (size_t i = lo; i <= hi; i++) bracketsPull(b, i);
+	}
+	b->valid = b->top = b->n;
+}
+
+void editorBracketsReplace(struct editorConfig *E, size_t at, size_t del, size_t count) {
+	struct editorBrackets *b = &E->brackets;
+	size_t n = b->n - del + count;
+	if (n > b->cap) {
+		size_t cap = b->cap ? b->cap : 64;
+		while (cap < n) cap *= 2;
+		struct bracketSummary *t = memAlloc(MEM_ROWS, sizeof(struct bracketSummary) * 2 * cap);
+		for (size_t i = 0; i < 2 * cap; i++) t[i] = brackets_none;
+		if (b->n) memcpy(&t[cap], &b->t[b->cap], sizeof(struct bracketSummary) * b->n);
+		memFree(b->t);
+		b->t = t;
+		b->cap = cap;
+		b->valid = 0;
+	}
+	// the leaves after the replaced ones move, new rows have no brackets
+	// until they're highlighted and those past the end are emptied
+	struct bracketSummary *leaf = &b->t[b->cap];
+	memmove(&leaf[at + count], &leaf[at + del], sizeof(struct bracketSummary) * (b->n - at - del));
+	for (size_t j = at; j < at + count; j++) leaf[j] = brackets_none;
+	for (size_t j = n; j < b->n; j++) leaf[j] = brackets_none;
+	if (b->n > b->top) b->top = b->n;
+	b->n = n;
+	if (b->valid > at) b->valid = at;
+}
+
+void editorBracketsChanged(struct editorConfig *E, size_t at) {
+	struct editorBrackets *b = &E->brackets;
+	if (at >= b->n) return;
+	size_t i = b->cap + at;
+	b->t[i] = E->row[at].brackets;
+	if (at >= b->valid) return;
+	for (i /= 2; i > 0; i /= 2) bracketsPull(b, i);
+}
+
+void editorBracketsRows(struct editorConfig *E, size_t from, size_t to) {
+	struct editorBrackets *b = &E->brackets;
+	if (to > b->n) to = b->n;
+	for (size_t j = from; j < to; j++) b->t[b->cap + j] = E->row[j].brackets;
+	if (b->valid > from) b->valid = from;
+}
+
+// the first row from `from` on where *open unclosed brackets get closed,
+// -1 if none does (*open is what's left then). Node i covers rows
+// [lo, hi)
+static ssize_t bracketsForward(struct editorBrackets *b, size_t i, size_t lo, size_t hi,
+		size_t from, int *open) {
+	if (hi <= from) return -1;
+	if (lo >= from && *open + b->t[i].min > 0) {
+		*open += b->t[i].delta;
+		return -1;
+	}
+	if (hi - lo == 1) return lo;
+	size_t mid = (lo + hi) / 2;
+	ssize_t r = bracketsForward(b, 2 * i, lo, mid, from, open);
+	return r != -1 ? r : bracketsForward(b, 2 * i + 1, mid, hi, from, open);
+}
+
+// the last row before `to` where *close unopened brackets get opened
+static ssize_t bracketsBackward(struct editorBrackets *b, size_t i, size_t lo, size_t hi,
+		size_t to, int *close) {
+	if (lo >= to) return -1;
+	if (hi <= to && b->t[i].max < *close) {
+		*close -= b->t[i].delta;
+		return -1;
+	}
+	if (hi - lo == 1) return lo;
+	size_t mid = (lo + hi) / 2;
+	ssize_t r = bracketsBackward(b, 2 * i + 1, mid, hi, to, close);
+	return r != -1 ? r : bracketsBackward(b, 2 * i, lo, mid, to, close);
+}
+
+// where in a row a count of brackets is matched, scanning from render
+// index i in direction dir (1 or -1), -1 if it isn't
+static ssize_t bracketsScan(erow *row, ssize_t i, int dir, int *count) {
+	for (; i >= 0 && (size_t)i < row->rsize; i += dir) {
+		*count += bracketAt(row, i) * dir;
+		if (*count == 0) return i;
+	}
+	return -1;
+}
+
+static int bracketsPair(char open, char close) {
+	return (open == '(' && close == ')') || (open == '[' && close == ']') ||
+		(open == '{' && close == '}');
+}
+
+int editorBracketMatch(struct editorConfig *E, size_t cy, size_t cx, size_t *bx,
+		size_t *my, size_t *mx) {
+	if (cy >= E->numrows) return 0;
+	erow *row = &E->row[cy];
+	editorColdThaw(E, row);
+	if (row->chunks || row->hl == NULL) return 0;
+
+	// the bracket at cx, or else before it
+	ssize_t at = -1;
+	int dir = 0;
+	for (size_t k = 0; k < 2 && at == -1; k++) {
+		if (cx < k || cx - k >= row->size || !strchr("()[]{}", row->chars[cx - k])) continue;
+		size_t i = editorRowCxToRender(row, cx - k);
+		if (i < row->rsize && (dir = bracketAt(row, i)) != 0) at = i;
+	}
+	if (at == -1) return 0;
+
+	int count = 1;
+	ssize_t found = bracketsScan(row, at + dir, dir, &count);
+	erow *match = row;
+	if (found == -1) {
+		struct editorBrackets *b = &E->brackets;
+		bracketsRefresh(b);
+		ssize_t j = dir > 0 ? bracketsForward(b, 1, 0, b->cap, cy + 1, &count) :
+			bracketsBackward(b, 1, 0, b->cap, cy, &count);
+		if (j == -1) return 0;
+		match = &E->row[j];
+		editorColdThaw(E, match);
+		found = bracketsScan(match, dir > 0 ? 0 : (ssize_t)match->rsize - 1, dir, &count);
+		if (found == -1) return 0;
+	}
+
+	char c = row->render[at], m = match->render[found];
+	if (!(dir > 0 ? bracketsPair(c, m) : bracketsPair(m, c))) return 0;
+	*bx = editorRowRenderToCx(row, at);
+	*my = match->idx;
+	*mx = editorRowRenderToCx(match, found);
+	return 1;
+}
+
+void editorBracketsFree(struct editorConfig *E) {
+	memFree(E->brackets.t);
+	memset(&E->brackets, 0, sizeof(E->brackets));
+}
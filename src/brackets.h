@@ -0,0 +1,37 @@
+#ifndef __BRACKETS_H__
+#define __BRACKETS_H__
+
+#include "structs.h"
+
+// matching brackets: ()[]{} outside strings and comments (going by a
+// row's hl) nest together, a pair of different kinds doesn't match.
+// Each row keeps a summary of its brackets (struct bracketSummary),
+// worked out as it's highlighted, and a segment tree over the rows
+// combines them, so the row holding a match is found in O(log n)
+// however far away it is. Long rows count as having no brackets
+
+// work out the summary of a row that was just highlighted. Touches
+// nothing but the row, so rows can be done on any thread
+void editorBracketsRow(erow *row);
+
+// the del rows from at were replaced by count new ones (with no brackets
+// until they're highlighted). Leaves after them are moved in one
+// memmove, the nodes above them are brought up to date by the next query
+void editorBracketsReplace(struct editorConfig *E, size_t at, size_t del, size_t count);
+
+// row at has a new summary
+void editorBracketsChanged(struct editorConfig *E, size_t at);
+
+// rows [from, to) have new summaries (see editorHighlightRows)
+void editorBracketsRows(struct editorConfig *E, size_t from, size_t to);
+
+// the bracket under the cursor (the char at cx, or else the one before
+// it) of a row and its match: returns 1 with the bracket at *bx and the
+// match at (*my, *mx), 0 if there's no bracket or no match
+int editorBracketMatch(struct editorConfig *E, size_t cy, size_t cx, size_t *bx,
+	size_t *my, size_t *mx);
+
+// free the tree
+void editorBracketsFree(struct editorConfig *E);
+
+#endif
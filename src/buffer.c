@@ -1,15 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "buffer.h"
+#include "memory.h"
 
-struct abuf {
-	char *b;
-	int len;
-};
-
-void abAppend(struct abuf *ab, const char *s, int len) {
+void abAppend(struct abuf *ab, const char *s, size_t len) {
 	// allocate a block of memory
-	char *new = realloc(ab->b, ab->len + len);
+	char *new = memRealloc(MEM_FRAME, ab->b, ab->len + len);
 	if (new == NULL) return;
 	memcpy(&new[ab->len], s, len);
 	ab->b = new;
@@ -18,5 +15,5 @@ void abAppend(struct abuf *ab, const char *s, int len) {
 
 void abFree(struct abuf *ab) {
 	// deallocate the dynamic memory used by abuf
-	free(ab->b);
+	memFree(ab->b);
 }
\ No newline at end of file
@@ -1,18 +1,20 @@
 #ifndef __BUFFER_H__
 #define __BUFFER_H__
 
+#include <stddef.h>
+
 // instead of calling write() directly, append strings to a buffer
 // and write it out at the end
 struct abuf {
 	char *b;
-	int len;
+	size_t len;
 };
 
 // constructor for abuf
 #define ABUF_INIT { NULL, 0 }
 
 // append to buffer
-void abAppend(struct abuf *ab, const char *s, int len);
+void abAppend(struct abuf *ab, const char *s, size_t len);
 
 // free buffer
 void abFree(struct abuf *ab);
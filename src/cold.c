@@ -0,0 +1,174 @@
+#include <string.h>
+#include "constants.h"
+#include "structs.h"
+#include "cold.h"
+#include "lz.h"
+#include "row.h"
+#include "memory.h"
+
+static void coldUnlink(struct editorCold *c, struct coldBlock *b) {
+	if (b->prev) b->prev->next = b->next;
+	else c->first = b->next;
+	if (b->next) b->next->prev = b->prev;
+	else c->last = b->prev;
+	b->prev = b->next = NULL;
+}
+
+static void coldPushFront(struct editorCold *c, struct coldBlock *b) {
+	b->prev = NULL;
+	b->next = c->first;
+	if (c->first) c->first->prev = b;
+	else c->last = b;
+	c->first = b;
+}
+
+// drop a block's text, and the block once no row is in it
+static void coldEvict(struct editorCold *c, struct coldBlock *b) {
+	coldUnlink(c, b);
+	c->cached--;
+	memFree(b->text);
+	b->text = NULL;
+	if (b->rows == 0) {
+		memFree(b->data);
+		memFree(b);
+	}
+}
+
+// a block's text, decompressing it into the cache if it isn't there
+static const char *coldText(struct editorConfig *E, struct coldBlock *b) {
+	struct editorCold *c = &E->cold;
+	if (b->text) {
+		if (c->first != b) {
+			coldUnlink(c, b);
+			coldPushFront(c, b);
+		}
+		return b->text;
+	}
+	b->text = memAlloc(MEM_COLD, b->raw);
+	// the data was compressed here, it can't be corrupt
+	lzDecompress(b->data, b->len, (unsigned char *)b->text, b->raw);
+	coldPushFront(c, b);
+	c->cached++;
+	while (c->cached > EDITOR_COLD_CACHE) coldEvict(c, c->last);
+	return b->text;
+}
+
+void editorColdThaw(struct editorConfig *E, erow *row) {
+	if (row->cold == NULL) return;
+	const char *text = coldText(E, row->cold);
+	row->chars = memAlloc(MEM_CHARS, row->size + 1);
+	memcpy(row->chars, text + row->cold_at, row->size + 1);
+	editorColdDrop(row);
+	editorRowRestore(E, row);
+	// it may have to be frozen again later
+	E->cold.left = E->numrows;
+}
+
+const char *editorColdChars(struct editorConfig *E, erow *row) {
+	if (row->cold == NULL) return row->chars;
+	return coldText(E, row->cold) + row->cold_at;
+}
+
+void editorColdDrop(erow *row) {
+	struct coldBlock *b = row->cold;
+	if (b == NULL) return;
+	row->cold = NULL;
+	// a cached block goes when it's evicted
+	if (--b->rows == 0 && b->text == NULL) {
+		memFree(b->data);
+		memFree(b);
+	}
+}
+
+// compress the raw bytes of text of rows [from, to) into one block and
+// make them its rows, leaving their chars, render and hl to the caller
+static void coldBlockFill(struct editorConfig *E, size_t from, size_t to, const char *text,
+		size_t raw) {
+	struct coldBlock *b = memAlloc(MEM_COLD, sizeof(struct coldBlock));
+	b->data = memAlloc(MEM_COLD, lzBound(raw));
+	b->len = lzCompress((unsigned char *)text, raw, b->data);
+	b->data = memRealloc(MEM_COLD, b->data, b->len);
+	b->raw = raw;
+	b->rows = to - from;
+	b->text = NULL;
+	b->prev = b->next = NULL;
+
+	size_t at = 0;
+	for (size_t j = from; j < to; j++) {
+		E->row[j].cold = b;
+		E->row[j].cold_at = at;
+		at += E->row[j].size + 1;
+	}
+}
+
+void editorColdLoad(struct editorConfig *E, size_t from, size_t to, const char *text) {
+	size_t raw = 0;
+	for (size_t j = from; j < to; j++) raw += E->row[j].size + 1;
+	coldBlockFill(E, from, to, text, raw);
+}
+
+// freeze rows [from, to) into one block
+static void coldFreeze(struct editorConfig *E, size_t from, size_t to) {
+	size_t raw = 0;
+	for (size_t j = from; j < to; j++) raw += E->row[j].size + 1;
+	char *text = memAlloc(MEM_COLD, raw);
+	size_t at = 0;
+	for (size_t j = from; j < to; j++) {
+		memcpy(text + at, E->row[j].chars, E->row[j].size + 1);
+		at += E->row[j].size + 1;
+	}
+	coldBlockFill(E, from, to, text, raw);
+	memFree(text);
+
+	for (size_t j = from; j < to; j++) {
+		erow *row = &E->row[j];
+		memFree(row->chars);
+		memFree(row->render);
+		memFree(row->hl);
+		row->chars = row->render = NULL;
+		row->hl = NULL;
+	}
+}
+
+int editorColdSweep(struct editorConfig *E) {
+	struct editorCold *c = &E->cold;
+	// rows near the view and the cursor stay as they are
+	size_t lo = E->rowoff < E->cy ? E->rowoff : E->cy;
+	size_t hi = E->rowoff + E->screenrows > E->cy + 1 ? E->rowoff + E->screenrows : E->cy + 1;
+	lo = lo > EDITOR_COLD_DISTANCE ? lo - EDITOR_COLD_DISTANCE : 0;
+	hi += EDITOR_COLD_DISTANCE;
+	if (lo == 0 && hi >= E->numrows) c->left = 0;
+
+	size_t budget = EDITOR_COLD_SWEEP_ROWS;
+	while (c->left > 0 && budget > 0) {
+		if (c->sweep >= E->numrows) c->sweep = 0;
+		if (c->sweep >= lo && c->sweep < hi) c->sweep = hi < E->numrows ? hi : 0;
+
+		// a run of hot rows (short ones, long rows keep their chunks)
+		size_t from = c->sweep, to = from, raw = 0;
+		while (to < E->numrows && (to < lo || to >= hi) && raw < EDITOR_COLD_BLOCK) {
+			erow *row = &E->row[to];
+			if (row->cold || row->shared || row->stale || row->chunks || row->size >= EDITOR_LONG_ROW / 2) break;
+			raw += row->size + 1;
+			to++;
+		}
+		if (to > from) coldFreeze(E, from, to);
+		else to = from + 1;
+
+		size_t n = to - from;
+		c->sweep = to;
+		c->left = c->left > n ? c->left - n : 0;
+		budget = budget > n ? budget - n : 0;
+	}
+	return c->left > 0;
+}
+
+int editorColdPending(struct editorConfig *E) {
+	return E->cold.left > 0;
+}
+
+void editorColdFree(struct editorConfig *E) {
+	struct editorCold *c = &E->cold;
+	while (c->first) coldEvict(c, c->first);
+	memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,40 @@
+#ifndef __COLD_H__
+#define __COLD_H__
+
+#include "structs.h"
+
+// rows far from the view (cold rows) give up their chars, render and hl:
+// their chars go into a block shared with the rows around them,
+// compressed with lz.h, and the rest is redone when a row is thawed.
+// A row is thawed (made an ordinary row again) by whatever needs it,
+// drawing, editing or highlighting; searching and saving only read its
+// chars. Decompressed blocks are kept in a small LRU cache, so touching
+// a screenful of cold rows decompresses a block or two.
+// The front end runs editorColdSweep while it's idle to freeze rows
+
+// make a cold row an ordinary one again, nothing for other rows
+void editorColdThaw(struct editorConfig *E, erow *row);
+
+// the chars of a row, null terminated, without thawing it. For a cold
+// row they stay valid until the next call into this file
+const char *editorColdChars(struct editorConfig *E, erow *row);
+
+// freeze some of the rows far from the view, returns 1 if there's more
+// to do (the sweep starts again when rows are thawed or added)
+int editorColdSweep(struct editorConfig *E);
+
+// the sweep has work to do
+int editorColdPending(struct editorConfig *E);
+
+// make rows [from, to), which have sizes but no chars (see
+// editorLoadRowsBare), cold with their chars taken from text: each row's
+// followed by a null byte
+void editorColdLoad(struct editorConfig *E, size_t from, size_t to, const char *text);
+
+// a row stops being cold without being thawed (it's freed)
+void editorColdDrop(erow *row);
+
+// free the cache, once every row is freed
+void editorColdFree(struct editorConfig *E);
+
+#endif
@@ -18,4 +18,91 @@
 // bit flag for highlighting strings (0000 0010)
 #define HL_HIGHLIGHT_STRINGS (1<<1)
 
+// what a row needs redone when an edit is committed (see editorBeginEdit)
+#define ROW_STALE_RENDER (1<<0)
+#define ROW_STALE_SYNTAX (1<<1)
+#define ROW_STALE_WORDS (1<<2) // out of the identifier index until then
+
+// rows of at least this many bytes are kept in chunks (see longrow.h) and
+// go back to a flat render once they shrink below half of it
+#define EDITOR_LONG_ROW (1 << 16)
+
+// bytes per chunk of a long row, chunks stay within a quarter and twice that
+#define EDITOR_ROW_CHUNK 4096
+
+// editorHighlightRows and editorReplaceAll only spawn a thread per this
+// many rows
+#define EDITOR_HL_CHUNK_MIN_ROWS 16384
+
+// editorRowsSwapped re-highlights the whole range of the rows it's given
+// when at least one in this many is among them
+#define EDITOR_SWAP_SPAN 8
+
+// upper bound on worker threads used by the core
+#define EDITOR_MAX_THREADS 64
+
+// counted B-tree (see counts.h): children of an inner node, or counts in
+// a leaf
+#define EDITOR_COUNTS_FANOUT 64
+
+// follow mode (see follow.h): bytes per read, batches the reader can get
+// ahead of the main loop, how long the main loop spends appending rows
+// before it repaints (ns) and how often a followed file is polled at its
+// end (ms)
+#define EDITOR_FOLLOW_READ (1 << 16)
+#define EDITOR_FOLLOW_QUEUE 256
+#define EDITOR_FOLLOW_BUDGET_NS 8000000
+#define EDITOR_FOLLOW_POLL_MS 100
+
+// cold rows (see cold.h): rows at least this far from the view are
+// frozen, into blocks of about this many bytes, a sweep looks at this
+// many rows before handing back to the main loop and this many blocks
+// are kept decompressed
+#define EDITOR_COLD_DISTANCE 4096
+#define EDITOR_COLD_BLOCK (1 << 16)
+#define EDITOR_COLD_SWEEP_ROWS 16384
+#define EDITOR_COLD_CACHE 16
+
+// identifier index (see words.h): words shorter or longer than these are
+// left out, a sweep indexes this many rows before handing back to the
+// main loop, words new since the index was last sorted are looked
+// through one by one up to this many, and completion offers at most
+// this many words
+#define EDITOR_WORDS_MIN_LEN 3
+#define EDITOR_WORDS_MAX_LEN 128
+#define EDITOR_WORDS_SWEEP_ROWS 16384
+#define EDITOR_WORDS_RECENT 4096
+#define EDITOR_COMPLETE_MAX 16
+
+// diff gutter (see diff.h): rows hashed per idle sweep, and the most
+// edits the diff looks for before calling the rest one change
+#define EDITOR_DIFF_SWEEP_ROWS 65536
+#define EDITOR_DIFF_MAX_EDITS 1024
+
+// session cache (see fileio.c): the smallest file worth writing
+// "<file>.session" for
+#define EDITOR_SESSION_MIN_SIZE (1 << 20)
+
+// save journal (see fileio.c): the unit the bytes a save replaces are
+// hashed in (a page, the unit a crash tends to leave old or new), and
+// how many blocks are read at a time to hash or check them
+#define EDITOR_JOURNAL_BLOCK 4096
+#define EDITOR_JOURNAL_READ 256
+
+// highlight cache (see hlcache.h): slots, the longest render (in bytes)
+// a slot holds, and the most rows a hit row keeps out of its slot
+#define EDITOR_HL_CACHE_SLOTS 8192
+#define EDITOR_HL_CACHE_MAX_LINE 160
+#define EDITOR_HL_CACHE_USES 8
+
+// line interning (see intern.h): a sweep looks at this many rows before
+// handing back to the main loop
+#define EDITOR_INTERN_SWEEP_ROWS 16384
+
+// latency histograms keep 2^STATS_SUB_BITS linear buckets per power of two
+// (~6% precision) and cover values up to 2^STATS_MAX_EXP nanoseconds (~18 min)
+#define STATS_SUB_BITS 4
+#define STATS_MAX_EXP 40
+#define STATS_BUCKETS ((STATS_MAX_EXP - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+
 #endif
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include <string.h>
+#include "constants.h"
+#include "counts.h"
+#include "memory.h"
+
+#define FANOUT EDITOR_COUNTS_FANOUT
+
+static struct countNode *countsNode(int leaf) {
+	struct countNode *node = memAlloc(MEM_ROWS, sizeof(*node));
+	node->n = 0;
+	node->rows = 0;
+	node->sum = 0;
+	node->leaf = leaf;
+	return node;
+}
+
+static void countsFreeNode(struct countNode *node) {
+	if (!node->leaf)
+		for (size_t k = 0; k < node->n; k++) countsFreeNode(node->u.child[k]);
+	memFree(node);
+}
+
+void countsInit(struct countTree *t) {
+	t->root = NULL;
+}
+
+void countsFree(struct countTree *t) {
+	if (t->root) countsFreeNode(t->root);
+	countsInit(t);
+}
+
+// the child of an inner node that count i (i <= rows) is under, leaving
+// i relative to that child
+static size_t countsChild(struct countNode *node, size_t *i) {
+	// appends and reads near the end are the common case, so the last
+	// child is tried first
+	size_t before = node->rows - node->u.child[node->n - 1]->rows;
+	if (*i >= before) {
+		*i -= before;
+		return node->n - 1;
+	}
+	size_t k = 0;
+	while (*i >= node->u.child[k]->rows) {
+		*i -= node->u.child[k]->rows;
+		k++;
+	}
+	return k;
+}
+
+// move what child k of an inner node holds from keep on into a new
+// node right after it
+static void countsSplit(struct countNode *parent, size_t k, size_t keep) {
+	struct countNode *child = parent->u.child[k];
+	struct countNode *next = countsNode(child->leaf);
+	next->n = child->n - keep;
+	if (child->leaf) {
+		memcpy(next->u.count, &child->u.count[keep], sizeof(size_t) * next->n);
+		for (size_t j = 0; j < next->n; j++) next->sum += next->u.count[j];
+		next->rows = next->n;
+	} else {
+		memcpy(next->u.child, &child->u.child[keep], sizeof(next->u.child[0]) * next->n);
+		for (size_t j = 0; j < next->n; j++) {
+			next->rows += next->u.child[j]->rows;
+			next->sum += next->u.child[j]->sum;
+		}
+	}
+	child->n = keep;
+	child->rows -= next->rows;
+	child->sum -= next->sum;
+	memmove(&parent->u.child[k + 2], &parent->u.child[k + 1],
+		sizeof(parent->u.child[0]) * (parent->n - k - 1));
+	parent->u.child[k + 1] = next;
+	parent->n++;
+}
+
+// where to split a full node that count i is about to go in: appending
+// leaves it full and starts a new one, so files read front to back end
+// up with full nodes; anywhere else it's halved
+static size_t countsSplitAt(struct countNode *node, size_t i) {
+	return i == node->rows ? FANOUT - 1 : FANOUT / 2;
+}
+
+void countsInsert(struct countTree *t, size_t i, size_t count) {
+	if (!t->root) t->root = countsNode(1);
+	if (i > t->root->rows) i = t->root->rows;
+	if (t->root->n == FANOUT) {
+		struct countNode *root = countsNode(0);
+		root->u.child[0] = t->root;
+		root->n = 1;
+		root->rows = t->root->rows;
+		root->sum = t->root->sum;
+		countsSplit(root, 0, countsSplitAt(t->root, i));
+		t->root = root;
+	}
+	// full nodes are split on the way down, so the leaf has room
+	struct countNode *node = t->root;
+	while (!node->leaf) {
+		size_t k = countsChild(node, &i);
+		struct countNode *child = node->u.child[k];
+		if (child->n == FANOUT) {
+			countsSplit(node, k, countsSplitAt(child, i));
+			if (i > child->rows) {
+				i -= child->rows;
+				child = node->u.child[k + 1];
+			}
+		}
+		node->rows++;
+		node->sum += count;
+		node = child;
+	}
+	memmove(&node->u.count[i + 1], &node->u.count[i], sizeof(size_t) * (node->n - i));
+	node->u.count[i] = count;
+	node->n++;
+	node->rows++;
+	node->sum += count;
+}
+
+// after a delete under child k of an inner node: drop the child if it's
+// empty, or fold it into a neighbour if it's down to a quarter full and
+// the two fit in one node
+static void countsMerge(struct countNode *node, size_t k) {
+	struct countNode *child = node->u.child[k];
+	size_t at;
+	if (child->n >= FANOUT / 4) return;
+	if (child->n == 0) {
+		memFree(child);
+		at = k;
+	} else {
+		if (k + 1 < node->n && child->n + node->u.child[k + 1]->n <= FANOUT) at = k + 1;
+		else if (k > 0 && node->u.child[k - 1]->n + child->n <= FANOUT) at = k;
+		else return;
+		struct countNode *left = node->u.child[at - 1], *right = node->u.child[at];
+		if (left->leaf)
+			memcpy(&left->u.count[left->n], right->u.count, sizeof(size_t) * right->n);
+		else
+			memcpy(&left->u.child[left->n], right->u.child, sizeof(right->u.child[0]) * right->n);
+		left->n += right->n;
+		left->rows += right->rows;
+		left->sum += right->sum;
+		memFree(right);
+	}
+	memmove(&node->u.child[at], &node->u.child[at + 1], sizeof(node->u.child[0]) * (node->n - at - 1));
+	node->n--;
+}
+
+// delete count i (i < rows) under a node, returning it
+static size_t countsRemove(struct countNode *node, size_t i) {
+	size_t count;
+	if (node->leaf) {
+		count = node->u.count[i];
+		memmove(&node->u.count[i], &node->u.count[i + 1], sizeof(size_t) * (node->n - i - 1));
+		node->n--;
+	} else {
+		size_t k = countsChild(node, &i);
+		count = countsRemove(node->u.child[k], i);
+		countsMerge(node, k);
+	}
+	node->rows--;
+	node->sum -= count;
+	return count;
+}
+
+void countsDelete(struct countTree *t, size_t i) {
+	if (!t->root || i >= t->root->rows) return;
+	countsRemove(t->root, i);
+	// a root with one child is replaced by it
+	while (!t->root->leaf && t->root->n == 1) {
+		struct countNode *root = t->root;
+		t->root = root->u.child[0];
+		memFree(root);
+	}
+	if (t->root->n == 0) countsFree(t);
+}
+
+void countsReplace(struct countTree *t, size_t i, size_t del, const size_t *counts, size_t count) {
+	size_t n = t->root ? t->root->rows : 0;
+	if (i > n) i = n;
+	if (del > n - i) del = n - i;
+	for (size_t k = 0; k < del; k++) countsDelete(t, i);
+	for (size_t k = 0; k < count; k++) countsInsert(t, i + k, counts[k]);
+}
+
+void countsAdd(struct countTree *t, size_t i, ssize_t delta) {
+	struct countNode *node = t->root;
+	// unsigned wraparound takes care of negative deltas
+	while (!node->leaf) {
+		node->sum += (size_t)delta;
+		node = node->u.child[countsChild(node, &i)];
+	}
+	node->sum += (size_t)delta;
+	node->u.count[i] += (size_t)delta;
+}
+
+void countsSet(struct countTree *t, size_t i, size_t count) {
+	countsAdd(t, i, (ssize_t)(count - countsGet(t, i)));
+}
+
+size_t countsGet(struct countTree *t, size_t i) {
+	struct countNode *node = t->root;
+	while (!node->leaf) node = node->u.child[countsChild(node, &i)];
+	return node->u.count[i];
+}
+
+size_t countsPrefix(struct countTree *t, size_t i) {
+	struct countNode *node = t->root;
+	if (!node) return 0;
+	if (i >= node->rows) return node->sum;
+	size_t sum = 0;
+	while (!node->leaf) {
+		size_t k = 0;
+		for (; i >= node->u.child[k]->rows; k++) {
+			sum += node->u.child[k]->sum;
+			i -= node->u.child[k]->rows;
+		}
+		node = node->u.child[k];
+	}
+	for (size_t k = 0; k < i; k++) sum += node->u.count[k];
+	return sum;
+}
+
+size_t countsSearch(struct countTree *t, size_t sum) {
+	struct countNode *node = t->root;
+	if (!node) return 0;
+	if (sum >= node->sum) return node->rows;
+	size_t pos = 0;
+	while (!node->leaf) {
+		size_t k = 0;
+		for (; node->u.child[k]->sum <= sum; k++) {
+			sum -= node->u.child[k]->sum;
+			pos += node->u.child[k]->rows;
+		}
+		node = node->u.child[k];
+	}
+	for (size_t k = 0; node->u.count[k] <= sum; k++) {
+		sum -= node->u.count[k];
+		pos++;
+	}
+	return pos;
+}
@@ -0,0 +1,42 @@
+#ifndef __COUNTS_H__
+#define __COUNTS_H__
+
+#include <sys/types.h>
+#include "structs.h"
+
+// sequence of counts kept as a counted B-tree: each node knows how many
+// counts are under it and their sum, so reading, changing, inserting or
+// deleting a count, prefix sums and finding where a prefix reaches a sum
+// all walk one path from the root and are O(log n)
+
+// an empty tree
+void countsInit(struct countTree *t);
+
+// free the tree, leaving it empty
+void countsFree(struct countTree *t);
+
+// insert a count before count i (i == n appends)
+void countsInsert(struct countTree *t, size_t i, size_t count);
+
+// delete count i
+void countsDelete(struct countTree *t, size_t i);
+
+// replace counts [i, i + del) with the count given ones
+void countsReplace(struct countTree *t, size_t i, size_t del, const size_t *counts, size_t count);
+
+// add delta to count i
+void countsAdd(struct countTree *t, size_t i, ssize_t delta);
+
+// set count i
+void countsSet(struct countTree *t, size_t i, size_t count);
+
+// count i
+size_t countsGet(struct countTree *t, size_t i);
+
+// sum of counts [0, i)
+size_t countsPrefix(struct countTree *t, size_t i);
+
+// the largest i with countsPrefix(t, i) <= sum (counts must be positive)
+size_t countsSearch(struct countTree *t, size_t sum);
+
+#endif
@@ -0,0 +1,408 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "constants.h"
+#include "enums.h"
+#include "structs.h"
+#include "diff.h"
+#include "cold.h"
+#include "memory.h"
+
+// a diff run in the background, on copies of what it needs
+struct diffJob {
+	uint32_t *rows; // hashes of the rows
+	size_t nrows;
+	const uint32_t *base; // of the file's lines, borrowed
+	size_t nbase;
+	int reread; // read the file for its lines instead (NULL path: none)
+	char *path;
+	uint32_t *read; // the lines read
+	size_t nread;
+	size_t gen, base_gen; // editorDiff's as the job started
+	struct diffHunk *hunks;
+	size_t nhunks, cap;
+	int wake;
+	int done; // set (atomically) once the job is done
+	int started; // on a thread of its own
+	pthread_t thread;
+};
+
+uint32_t editorDiffHash(const char *s, size_t len) {
+	// four lanes over 32 bytes at a time, independent of each other so
+	// they can go side by side (or in one vector register)
+	uint64_t lane[4] = {
+		0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull
+	};
+	size_t i = 0;
+	for (; i + 32 <= len; i += 32) {
+		for (int k = 0; k < 4; k++) {
+			uint64_t w;
+			memcpy(&w, s + i + 8 * k, 8);
+			lane[k] = (lane[k] ^ w) * 0x100000001b3ull;
+			lane[k] ^= lane[k] >> 29;
+		}
+	}
+	uint64_t h = len;
+	for (int k = 0; k < 4; k++) h = (h ^ lane[k]) * 0xff51afd7ed558ccdull;
+	for (; i < len; i++) h = (h ^ (unsigned char)s[i]) * 0x100000001b3ull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	uint32_t r = (uint32_t)h;
+	return r ? r : 1;
+}
+
+/*** the job ***/
+
+static void diffHunkAdd(struct diffJob *j, size_t at, size_t add, size_t del) {
+	if (j->nhunks == j->cap) {
+		j->cap = j->cap ? j->cap * 2 : 16;
+		j->hunks = memRealloc(MEM_DIFF, j->hunks, sizeof(struct diffHunk) * j->cap);
+	}
+	j->hunks[j->nhunks].at = at;
+	j->hunks[j->nhunks].add = add;
+	j->hunks[j->nhunks].del = del;
+	j->nhunks++;
+}
+
+// hashes of the lines of a file, split as editorLoadLines does. A file
+// that can't be read has none
+static uint32_t *diffReadFile(const char *path, size_t *n) {
+	*n = 0;
+	int fd = path ? open(path, O_RDONLY) : -1;
+	if (fd == -1) return NULL;
+	size_t cap = EDITOR_FOLLOW_READ, len = 0, ncap = 1024;
+	char *buf = memAlloc(MEM_FILEIO, cap);
+	uint32_t *lines = memAlloc(MEM_DIFF, sizeof(uint32_t) * ncap);
+	for (;;) {
+		if (len == cap) buf = memRealloc(MEM_FILEIO, buf, cap *= 2);
+		ssize_t got = read(fd, buf + len, cap - len);
+		if (got == -1 && errno == EINTR) continue;
+		if (got <= 0) break;
+		len += got;
+		// hash the complete lines, keep the rest for the next read
+		char *p = buf, *end = buf + len, *nl;
+		while ((nl = memchr(p, '\n', end - p)) != NULL) {
+			size_t linelen = nl - p;
+			while (linelen > 0 && p[linelen - 1] == '\r') linelen--;
+			if (*n == ncap) lines = memRealloc(MEM_DIFF, lines, sizeof(uint32_t) * (ncap *= 2));
+			lines[(*n)++] = editorDiffHash(p, linelen);
+			p = nl + 1;
+		}
+		len = end - p;
+		memmove(buf, p, len);
+	}
+	if (len > 0) {
+		while (len > 0 && buf[len - 1] == '\r') len--;
+		if (*n == ncap) lines = memRealloc(MEM_DIFF, lines, sizeof(uint32_t) * (ncap *= 2));
+		lines[(*n)++] = editorDiffHash(buf, len);
+	}
+	memFree(buf);
+	close(fd);
+	return lines;
+}
+
+// Myers' diff of lines a[0, n) of the file and rows b[0, m), which start
+// at row at. Hunks for every run of edits, or one for the lot if it
+// takes more than EDITOR_DIFF_MAX_EDITS
+static void diffMyers(struct diffJob *j, const uint32_t *a, ssize_t n, const uint32_t *b,
+		ssize_t m, size_t at) {
+	ssize_t max = n + m < EDITOR_DIFF_MAX_EDITS ? n + m : EDITOR_DIFF_MAX_EDITS;
+	// v[off + k] is how far along a the furthest path on diagonal k = x - y
+	// gets, and trace has v[-d, d] for each d, at d * d
+	ssize_t off = max + 1;
+	ssize_t *v = memAlloc(MEM_DIFF, sizeof(ssize_t) * (2 * max + 3));
+	ssize_t *trace = NULL;
+	size_t tracecap = 0; // entries trace has room for, doubled as it fills
+	ssize_t d, found = -1;
+	v[off + 1] = 0;
+	for (d = 0; d <= max && found == -1; d++) {
+		for (ssize_t k = -d; k <= d; k += 2) {
+			ssize_t x = k == -d || (k != d && v[off + k - 1] < v[off + k + 1]) ?
+				v[off + k + 1] : v[off + k - 1] + 1;
+			ssize_t y = x - k;
+			while (x < n && y < m && a[x] == b[y]) {
+				x++;
+				y++;
+			}
+			v[off + k] = x;
+			if (x >= n && y >= m) {
+				found = d;
+				break;
+			}
+		}
+		if ((size_t)((d + 1) * (d + 1)) > tracecap) {
+			tracecap = tracecap ? tracecap * 2 : 64;
+			while (tracecap < (size_t)((d + 1) * (d + 1))) tracecap *= 2;
+			trace = memRealloc(MEM_DIFF, trace, sizeof(ssize_t) * tracecap);
+		}
+		memcpy(&trace[d * d], &v[off - d], sizeof(ssize_t) * (2 * d + 1));
+	}
+	memFree(v);
+	if (found == -1) {
+		memFree(trace);
+		diffHunkAdd(j, at, m, n);
+		return;
+	}
+
+	// back from the end: each step is one row added (down) or one line
+	// deleted (right), after the snake of equal ones it ends with
+	struct { ssize_t x, y; int add; } *edits = memAlloc(MEM_DIFF, sizeof(*edits) * (found + 1));
+	ssize_t x = n, y = m;
+	for (d = found; d > 0; d--) {
+		ssize_t *pv = &trace[(d - 1) * (d - 1) + d - 1]; // pv[k] is v[k] for d - 1
+		ssize_t k = x - y;
+		int add = k == -d || (k != d && pv[k - 1] < pv[k + 1]);
+		ssize_t pk = add ? k + 1 : k - 1;
+		x = pv[pk];
+		y = x - pk;
+		edits[d - 1].x = x;
+		edits[d - 1].y = y;
+		edits[d - 1].add = add;
+	}
+	memFree(trace);
+
+	// runs of edits with nothing equal in between make a hunk
+	ssize_t hx = 0, hy = 0, hdel = 0, hadd = 0;
+	for (d = 0; d < found; d++) {
+		if (hdel + hadd == 0 || edits[d].x != hx + hdel || edits[d].y != hy + hadd) {
+			if (hdel + hadd) diffHunkAdd(j, at + hy, hadd, hdel);
+			hx = edits[d].x;
+			hy = edits[d].y;
+			hdel = hadd = 0;
+		}
+		if (edits[d].add) hadd++;
+		else hdel++;
+	}
+	if (hdel + hadd) diffHunkAdd(j, at + hy, hadd, hdel);
+	memFree(edits);
+}
+
+static void *diffRun(void *arg) {
+	struct diffJob *j = arg;
+	if (j->reread) {
+		j->read = diffReadFile(j->path, &j->nread);
+		j->base = j->read;
+		j->nbase = j->nread;
+	}
+	// only what's between the lines both start and end with is diffed
+	size_t n = j->nbase, m = j->nrows, pre = 0, suf = 0;
+	while (pre < n && pre < m && j->base[pre] == j->rows[pre]) pre++;
+	while (suf < n - pre && suf < m - pre && j->base[n - 1 - suf] == j->rows[m - 1 - suf]) suf++;
+	if (pre + suf < n || pre + suf < m)
+		diffMyers(j, j->base + pre, n - pre - suf, j->rows + pre, m - pre - suf, pre);
+
+	__atomic_store_n(&j->done, 1, __ATOMIC_RELEASE);
+	// if the pipe is full the main loop has yet to look anyway
+	ssize_t w = write(j->wake, "", 1);
+	(void)w;
+	return NULL;
+}
+
+static void diffJobFree(struct diffJob *j) {
+	if (j->started) pthread_join(j->thread, NULL);
+	memFree(j->rows);
+	memFree(j->read);
+	memFree(j->hunks);
+	free(j->path);
+	memFree(j);
+}
+
+// start a diff of the rows as they are now
+static void diffStart(struct editorConfig *E) {
+	struct editorDiff *d = &E->diff;
+	struct diffJob *j = memAlloc(MEM_DIFF, sizeof(struct diffJob));
+	memset(j, 0, sizeof(*j));
+	j->rows = memAlloc(MEM_DIFF, sizeof(uint32_t) * (d->n ? d->n : 1));
+	memcpy(j->rows, d->hash, sizeof(uint32_t) * d->n);
+	j->nrows = d->n;
+	j->gen = d->gen;
+	j->base_gen = d->base_gen;
+	if (d->base_done == d->base_gen) {
+		j->base = d->base;
+		j->nbase = d->nbase;
+	} else {
+		j->reread = 1;
+		j->path = E->filename ? strdup(E->filename) : NULL;
+	}
+	j->wake = d->wake[1];
+	d->job = j;
+	// without threads (a wasm build without pthreads) it runs right here
+	j->started = pthread_create(&j->thread, NULL, diffRun, j) == 0;
+	if (!j->started) diffRun(j);
+}
+
+/*** the rows ***/
+
+void editorDiffToggle(struct editorConfig *E) {
+	struct editorDiff *d = &E->diff;
+	if (d->on) {
+		editorDiffFree(E);
+		return;
+	}
+	if (pipe(d->wake) == -1) return;
+	fcntl(d->wake[0], F_SETFL, O_NONBLOCK);
+	d->on = 1;
+	d->n = d->cap = E->numrows;
+	d->hash = memAlloc(MEM_DIFF, sizeof(uint32_t) * (d->cap ? d->cap : 1));
+	memset(d->hash, 0, sizeof(uint32_t) * d->n);
+	d->lo = 0;
+	d->hi = d->n;
+	// nothing is up to date
+	d->gen = d->base_gen = 1;
+	d->done = d->base_done = 0;
+}
+
+int editorDiffGutter(struct editorConfig *E) {
+	return E->diff.on ? 1 : 0;
+}
+
+void editorDiffMove(struct editorConfig *E, size_t at, size_t del, size_t count) {
+	struct editorDiff *d = &E->diff;
+	if (!d->on) return;
+	size_t n = d->n - del + count;
+	if (n > d->cap) {
+		while (d->cap < n) d->cap = d->cap ? d->cap * 2 : 64;
+		d->hash = memRealloc(MEM_DIFF, d->hash, sizeof(uint32_t) * d->cap);
+	}
+	memmove(&d->hash[at + count], &d->hash[at + del], sizeof(uint32_t) * (d->n - at - del));
+	memset(&d->hash[at], 0, sizeof(uint32_t) * count);
+	d->n = n;
+	// the new rows are to be hashed along with the ones that were
+	if (d->lo >= d->hi) {
+		d->lo = at;
+		d->hi = at + count;
+	} else {
+		if (d->lo > at) d->lo = at;
+		d->hi = d->hi > at + del ? d->hi - del + count : at + count;
+	}
+	// the marks after the rows replaced stay on their rows
+	for (size_t k = 0; k < d->nhunks; k++)
+		if (d->hunks[k].at >= at + del) d->hunks[k].at = d->hunks[k].at - del + count;
+	d->gen++;
+}
+
+void editorDiffChanged(struct editorConfig *E, size_t at) {
+	struct editorDiff *d = &E->diff;
+	if (!d->on || at >= d->n) return;
+	d->hash[at] = 0;
+	if (d->lo >= d->hi) {
+		d->lo = at;
+		d->hi = at + 1;
+	} else {
+		if (d->lo > at) d->lo = at;
+		if (d->hi < at + 1) d->hi = at + 1;
+	}
+	d->gen++;
+}
+
+void editorDiffSynced(struct editorConfig *E) {
+	if (E->diff.on) E->diff.base_gen++;
+}
+
+char editorDiffMark(struct editorConfig *E, size_t row) {
+	struct editorDiff *d = &E->diff;
+	// the last hunk starting at or before row
+	size_t lo = 0, hi = d->nhunks;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (d->hunks[mid].at <= row) lo = mid + 1;
+		else hi = mid;
+	}
+	if (lo == 0) return ' ';
+	struct diffHunk *h = &d->hunks[lo - 1];
+	if (row < h->at + h->add) return row - h->at < h->del ? '~' : '+';
+	if (row == h->at + h->add && h->del > h->add) return '-';
+	return ' ';
+}
+
+/*** the main loop ***/
+
+int editorDiffSweep(struct editorConfig *E) {
+	struct editorDiff *d = &E->diff;
+	if (!d->on || d->job) return 0;
+	if (d->hi > d->n) d->hi = d->n;
+	size_t budget = EDITOR_DIFF_SWEEP_ROWS;
+	for (; d->lo < d->hi && budget > 0; d->lo++, budget--) {
+		if (d->hash[d->lo]) continue;
+		erow *row = &E->row[d->lo];
+		d->hash[d->lo] = editorDiffHash(editorColdChars(E, row), row->size);
+	}
+	if (d->lo < d->hi) return 1;
+	if (d->done != d->gen || d->base_done != d->base_gen) diffStart(E);
+	return 0;
+}
+
+int editorDiffPending(struct editorConfig *E) {
+	struct editorDiff *d = &E->diff;
+	return d->on && d->job == NULL &&
+		(d->lo < d->hi || d->done != d->gen || d->base_done != d->base_gen);
+}
+
+int editorDiffFd(struct editorConfig *E) {
+	return E->diff.on ? E->diff.wake[0] : -1;
+}
+
+int editorDiffService(struct editorConfig *E) {
+	struct editorDiff *d = &E->diff;
+	if (!d->on) return 0;
+	char drain[64];
+	while (read(d->wake[0], drain, sizeof(drain)) > 0);
+	struct diffJob *j = d->job;
+	if (j == NULL || !__atomic_load_n(&j->done, __ATOMIC_ACQUIRE)) return 0;
+	d->job = NULL;
+
+	// the file's lines hold until it's synced again, the hunks until the
+	// rows change
+	if (j->reread && j->base_gen == d->base_gen) {
+		memFree(d->base);
+		d->base = j->read;
+		d->nbase = j->nread;
+		d->base_done = j->base_gen;
+		j->read = NULL;
+	}
+	int repaint = 0;
+	if (j->gen == d->gen && j->base_gen == d->base_gen) {
+		memFree(d->hunks);
+		d->hunks = j->hunks;
+		d->nhunks = j->nhunks;
+		d->done = j->gen;
+		j->hunks = NULL;
+		repaint = 1;
+	}
+	diffJobFree(j);
+	return repaint;
+}
+
+void editorDiffFlush(struct editorConfig *E) {
+	struct editorDiff *d = &E->diff;
+	while (d->job || editorDiffPending(E)) {
+		if (d->job == NULL) {
+			editorDiffSweep(E);
+			continue;
+		}
+		if (!__atomic_load_n(&d->job->done, __ATOMIC_ACQUIRE)) {
+			struct pollfd pfd = { .fd = d->wake[0], .events = POLLIN };
+			poll(&pfd, 1, -1);
+		}
+		editorDiffService(E);
+	}
+}
+
+void editorDiffFree(struct editorConfig *E) {
+	struct editorDiff *d = &E->diff;
+	if (d->job) diffJobFree(d->job);
+	if (d->on) {
+		close(d->wake[0]);
+		close(d->wake[1]);
+	}
+	memFree(d->hash);
+	memFree(d->base);
+	memFree(d->hunks);
+	memset(d, 0, sizeof(*d));
+}
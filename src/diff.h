@@ -0,0 +1,60 @@
+#ifndef __DIFF_H__
+#define __DIFF_H__
+
+#include <stdint.h>
+#include "structs.h"
+
+// diff gutter: with it on, a column left of the text marks the rows that
+// differ from the file on disk, '+' added, '~' changed, and '-' where
+// lines were deleted. Every row's hash is kept in an array that follows
+// the rows (a changed row only needs hashing again), and the diff runs
+// on a thread of its own: on a copy of the array against the hashes of
+// the file's lines, read on that thread when the file was last synced.
+// It skips the lines both start and end with, then runs Myers' diff on
+// what's left, so an edit costs a pass over the hashes whatever the size
+// of the file. Until the next diff is in, the rows marked move along
+// with the rows they're on
+
+// turn the gutter on or off
+void editorDiffToggle(struct editorConfig *E);
+
+// columns the gutter takes
+int editorDiffGutter(struct editorConfig *E);
+
+// keep the hashes on the same rows when the del rows from at are replaced
+// by count new ones
+void editorDiffMove(struct editorConfig *E, size_t at, size_t del, size_t count);
+
+// the chars of row at changed
+void editorDiffChanged(struct editorConfig *E, size_t at);
+
+// the file on disk now holds the rows
+void editorDiffSynced(struct editorConfig *E);
+
+// what the gutter shows for a row: ' ', '+', '~' or '-'
+char editorDiffMark(struct editorConfig *E, size_t row);
+
+// hash some more rows, and once they're all hashed start a diff if the
+// last one is out of date. Returns 1 if there's more to do
+int editorDiffSweep(struct editorConfig *E);
+
+// the sweep has work to do
+int editorDiffPending(struct editorConfig *E);
+
+// descriptor that becomes readable when a diff is done, -1 if the gutter
+// is off
+int editorDiffFd(struct editorConfig *E);
+
+// take in a finished diff, returns 1 if the screen needs a repaint
+int editorDiffService(struct editorConfig *E);
+
+// bring the diff up to date now, waiting for it
+void editorDiffFlush(struct editorConfig *E);
+
+// a line's hash (never 0)
+uint32_t editorDiffHash(const char *s, size_t len);
+
+// stop the diff and free the gutter
+void editorDiffFree(struct editorConfig *E);
+
+#endif
@@ -1,40 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include "editor.h"
 #include "row.h"
+#include "memory.h"
+#include "counts.h"
+#include "watch.h"
+#include "follow.h"
+#include "cold.h"
+#include "intern.h"
+#include "hlcache.h"
+#include "diff.h"
+#include "words.h"
+#include "brackets.h"
+#include "wrap.h"
 
-void editorInsertChar(int c) {
-	if (E.cy == E.numrows) {
-		editorInsertRow(E.numrows, "", 0);
+void editorInit(struct editorConfig *E, int screenrows, int screencols) {
+	E->cx = 0;
+	E->cy = 0;
+	E->rx = 0;
+	E->rowoff = 0;
+	E->coloff = 0;
+	E->screenrows = screenrows;
+	E->screencols = screencols;
+	E->numrows = 0;
+	E->row = NULL;
+	countsInit(&E->offsets);
+	E->dirty = 0;
+	memset(&E->save, 0, sizeof(E->save));
+	E->save.first = 1;
+	E->save.last = 0;
+	E->edit.depth = 0;
+	E->edit.first = 1;
+	E->edit.last = 0;
+	E->watch.fd = -1;
+	E->watch.name = NULL;
+	E->follow = NULL;
+	memset(&E->cold, 0, sizeof(E->cold));
+	memset(&E->words, 0, sizeof(E->words));
+	memset(&E->brackets, 0, sizeof(E->brackets));
+	memset(&E->wrap, 0, sizeof(E->wrap));
+	memset(&E->intern, 0, sizeof(E->intern));
+	memset(&E->hlcache, 0, sizeof(E->hlcache));
+	memset(&E->diff, 0, sizeof(E->diff));
+	E->filename = NULL;
+	E->statusmsg[0] = '\0';
+	E->statusmsg_time = 0;
+	E->syntax = NULL;
+	E->find.last_match = -1;
+	E->find.direction = 1;
+	E->find.saved_hl_line = 0;
+	E->find.saved_hl = NULL;
+	E->stats = NULL;
+}
+
+void editorFree(struct editorConfig *E) {
+	for (size_t j = 0; j < E->numrows; j++) editorFreeRow(&E->row[j]);
+	memFree(E->row);
+	editorColdFree(E);
+	editorWordsFree(E);
+	editorBracketsFree(E);
+	editorWrapFree(E);
+	editorInternFree(E);
+	editorHlCacheFree(E);
+	editorDiffFree(E);
+	countsFree(&E->offsets);
+	editorWatchStop(E);
+	editorFollowStop(E);
+	free(E->filename);
+	memFree(E->find.saved_hl);
+	struct editorStats *stats = E->stats;
+	editorInit(E, E->screenrows, E->screencols);
+	E->stats = stats;
+}
+
+void editorInsertChar(struct editorConfig *E, int c) {
+	editorBeginEdit(E);
+	if (E->cy == E->numrows) {
+		editorInsertRow(E, E->numrows, "", 0);
 	}
-	editorRowInsertChar(&E.row[E.cy], E.cx, c);
-	E.cx++;
+	editorRowInsertChar(E, &E->row[E->cy], E->cx, c);
+	E->cx++;
+	editorCommitEdit(E);
 }
 
-void editorInsertNewline() {
-	if (E.cx == 0) {
-		editorInsertRow(E.cy, "", 0);
+void editorInsertNewline(struct editorConfig *E) {
+	editorBeginEdit(E);
+	if (E->cx == 0) {
+		editorInsertRow(E, E->cy, "", 0);
 	} else {
-		erow *row = &E.row[E.cy];
-		editorInsertRow(E.cy + 1, &row->chars[E.cx], row->size - E.cx);
-		row = &E.row[E.cy];
-		row->size = E.cx;
-		row->chars[row->size] = '\0';
-		editorUpdateRow(row);
+		erow *row = &E->row[E->cy];
+		editorColdThaw(E, row);
+		editorInsertRow(E, E->cy + 1, &row->chars[E->cx], row->size - E->cx);
+		editorRowTruncate(E, &E->row[E->cy], E->cx);
 	}
-	E.cy++;
-	E.cx = 0;
+	E->cy++;
+	E->cx = 0;
+	editorCommitEdit(E);
 }
 
-void editorDelChar() {
-	if (E.cy == E.numrows) return;
-	if (E.cx == 0 && E.cy == 0) return;
+void editorDelChar(struct editorConfig *E) {
+	if (E->cy == E->numrows) return;
+	if (E->cx == 0 && E->cy == 0) return;
 
-	erow *row = &E.row[E.cy];
-	if (E.cx > 0) {
-		editorRowDelChar(row, E.cx - 1);
-		E.cx--;
+	erow *row = &E->row[E->cy];
+	editorBeginEdit(E);
+	if (E->cx > 0) {
+		// the whole code point before the cursor
+		size_t at = editorRowPrevCx(E, row, E->cx);
+		while (E->cx > at) {
+			editorRowDelChar(E, row, at);
+			E->cx--;
+		}
 	} else {
-		E.cx = E.row[E.cy - 1].size;
-		editorRowAppendString(&E.row[E.cy - 1], row->chars, row->size);
-		editorDelRow(E.cy);
-		E.cy--;
+		E->cx = E->row[E->cy - 1].size;
+		editorColdThaw(E, row);
+		editorRowAppendString(E, &E->row[E->cy - 1], row->chars, row->size);
+		editorDelRow(E, E->cy);
+		E->cy--;
 	}
+	editorCommitEdit(E);
+}
+
+void editorGotoLine(struct editorConfig *E, size_t line) {
+	editorFollowWaitRows(E, line);
+	E->cy = line > 0 ? line - 1 : 0;
+	if (E->cy > E->numrows) E->cy = E->numrows;
+	E->cx = 0;
+}
+
+void editorGotoOffset(struct editorConfig *E, size_t offset) {
+	editorFollowWaitBytes(E, offset + 1);
+	E->cy = editorRowAtOffset(E, offset);
+	E->cx = 0;
+	if (E->cy < E->numrows) {
+		// an offset on the newline lands at the end of the row
+		E->cx = offset - editorRowOffset(E, E->cy);
+		if (E->cx > E->row[E->cy].size) E->cx = E->row[E->cy].size;
+		E->cx = editorRowSnapCx(E, &E->row[E->cy], E->cx);
+	}
+}
+
+size_t editorCursorOffset(struct editorConfig *E) {
+	return editorRowOffset(E, E->cy) + E->cx;
 }
@@ -1,14 +1,33 @@
 #ifndef __EDITOR_H__
 #define __EDITOR_H__
 
+#include "structs.h"
+
+// set up an empty editor context for a screen of the given size
+// (rows excludes the status and message bars)
+void editorInit(struct editorConfig *E, int screenrows, int screencols);
+
+// free every row and all other memory owned by an editor context,
+// leaving it empty (timing collection stays attached)
+void editorFree(struct editorConfig *E);
+
 // insert a character at cursor position
 // uses editorRowInsertChar under the hood with cursor position
-void editorInsertChar(int c);
+void editorInsertChar(struct editorConfig *E, int c);
 
 // insert a new line at cursor position
-void editorInsertNewline();
+void editorInsertNewline(struct editorConfig *E);
 
 // delete a character at cursor position
-void editorDelChar();
+void editorDelChar(struct editorConfig *E);
+
+// move the cursor to the start of a line (counting from 1)
+void editorGotoLine(struct editorConfig *E, size_t line);
+
+// move the cursor to a byte offset in the saved file
+void editorGotoOffset(struct editorConfig *E, size_t offset);
+
+// byte offset of the cursor in the saved file
+size_t editorCursorOffset(struct editorConfig *E);
 
-#endif
\ No newline at end of file
+#endif
@@ -27,7 +27,37 @@ enum EDITOR_HIGHLIGHT {
 	HL_MATCH
 };
 
+// Editor timing phases (for latency histograms)
+enum EDITOR_STAT {
+	STAT_READ_KEY = 0,
+	STAT_PROCESS_KEY,
+	STAT_UPDATE_SYNTAX,
+	STAT_DRAW_ROWS,
+	STAT_WRITE,
+	STAT_KEY_TO_PAINT,
+	STAT_COUNT
+};
+
+// Editor memory subsystems (for allocation accounting)
+enum EDITOR_MEM {
+	MEM_CHARS = 0,
+	MEM_RENDER,
+	MEM_HL,
+	MEM_ROWS,
+	MEM_FRAME,
+	MEM_SEARCH,
+	MEM_FILEIO,
+	MEM_COLD,
+	MEM_WORDS,
+	MEM_INTERN,
+	MEM_HLCACHE,
+	MEM_DIFF,
+	MEM_COUNT
+};
+
 extern enum EDITOR_KEY editorKey;
 extern enum EDITOR_HIGHLIGHT editorHighlight;
+extern enum EDITOR_STAT editorStat;
+extern enum EDITOR_MEM editorMem;
 
 #endif
\ No newline at end of file
@@ -1,84 +1,968 @@
 #include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "constants.h"
 #include "structs.h"
+#include "fileio.h"
 #include "highlight.h"
-#include "terminal.h"
 #include "row.h"
-#include "input.h"
 #include "output.h"
+#include "memory.h"
+#include "watch.h"
+#include "follow.h"
+#include "cold.h"
+#include "diff.h"
+#include "brackets.h"
 
-void *editorRowsToString(int *buflen) {
-	int totlen = 0;
-	int j;
-	for (j = 0; j < E.numrows; j++)
-		totlen += E.row[j].size + 1;
+// write() transfers at most ~2 GB per call on linux, so keep going
+// until the whole buffer is on disk
+static int writeAll(int fd, const char *buf, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd, buf, len);
+		if (n == -1) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// writeAll at a file offset
+static int pwriteAll(int fd, const char *buf, size_t len, off_t off) {
+	while (len > 0) {
+		ssize_t n = pwrite(fd, buf, len, off);
+		if (n == -1) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+		off += n;
+	}
+	return 0;
+}
+
+// read up to len bytes at a file offset, fewer only where the file
+// ends. Returns how many, or -1
+static ssize_t preadAll(int fd, char *buf, size_t len, off_t off) {
+	size_t got = 0;
+	while (got < len) {
+		ssize_t n = pread(fd, buf + got, len - got, off + got);
+		if (n == -1 && errno == EINTR) continue;
+		if (n == -1) return -1;
+		if (n == 0) break;
+		got += n;
+	}
+	return got;
+}
+
+static int readAll(int fd, char *buf, size_t len) {
+	while (len > 0) {
+		ssize_t n = read(fd, buf, len);
+		if (n == -1 && errno == EINTR) continue;
+		if (n <= 0) return -1;
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// rows [from, to) as they're saved (release with memFree)
+static char *editorRowsRange(struct editorConfig *E, size_t from, size_t to, size_t *buflen) {
+	size_t totlen = editorRowOffset(E, to) - editorRowOffset(E, from);
 	*buflen = totlen;
 
-	char *buf = malloc(totlen);
+	char *buf = memAlloc(MEM_FILEIO, totlen ? totlen : 1);
 	char *p = buf;
-	for (j = 0; j < E.numrows; j++) {
-		memcpy(p, E.row[j].chars, E.row[j].size);
-		p += E.row[j].size;
+	for (size_t j = from; j < to; j++) {
+		memcpy(p, editorColdChars(E, &E->row[j]), E->row[j].size);
+		p += E->row[j].size;
 		*p = '\n';
 		p++;
 	}
-
 	return buf;
 }
 
-void editorOpen(char *filename) {
-	free(E.filename); // strdup assumes you will free the memory
-	E.filename = strdup(filename);
+void *editorRowsToString(struct editorConfig *E, size_t *buflen) {
+	return editorRowsRange(E, 0, E->numrows, buflen);
+}
+
+/*** save journal ***/
+
+// a save first writes what it's going to change to
+// "<file>.journal", so a crash in the middle can be rolled forward on the
+// next open:
+//
+//   struct editorJournal, a hash of each block (EDITOR_JOURNAL_BLOCK
+//   aligned in the file) of the bytes [offset, offset + len) as they were
+//   before the save, then len bytes to write at offset, after which the
+//   file is truncated to size
+//
+// A journal that doesn't check out was cut short before the file itself
+// was touched, and is simply dropped. One that does is only applied to
+// the file it was written for, and only while each of its blocks still
+// holds the old bytes or the new ones (all a save cut short can leave);
+// a file changed some other way since keeps its journal and is left alone
+
+#define JOURNAL_MAGIC "wejrnl2"
+
+struct editorJournal {
+	char magic[8];
+	uint64_t dev, ino; // the file it's for
+	uint64_t old_size; // its size before the save
+	uint64_t offset;
+	uint64_t size;
+	uint64_t len;
+	uint64_t blocks; // hashes of the old bytes that follow the header
+	uint64_t sum; // FNV-1a of the fields above, the hashes and the data
+};
+
+#define FNV_BASIS 14695981039346656037ULL
+
+static uint64_t fnv1a(uint64_t h, const void *p, size_t n) {
+	const unsigned char *s = p;
+	for (size_t i = 0; i < n; i++) {
+		h ^= s[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static uint64_t editorJournalSum(struct editorJournal *j, const uint64_t *hashes,
+		const char *data) {
+	uint64_t h = fnv1a(FNV_BASIS, &j->dev, offsetof(struct editorJournal, sum) -
+		offsetof(struct editorJournal, dev));
+	h = fnv1a(h, hashes, j->blocks * sizeof(*hashes));
+	return fnv1a(h, data, j->len);
+}
+
+static uint64_t editorJournalBlocks(uint64_t offset, uint64_t len) {
+	if (len == 0) return 0;
+	return (offset + len - 1) / EDITOR_JOURNAL_BLOCK - offset / EDITOR_JOURNAL_BLOCK + 1;
+}
+
+// block k of the journal is the file's [*from, *to)
+static void editorJournalBlock(struct editorJournal *j, uint64_t k, uint64_t *from,
+		uint64_t *to) {
+	uint64_t start = (j->offset / EDITOR_JOURNAL_BLOCK + k) * EDITOR_JOURNAL_BLOCK;
+	uint64_t end = j->offset + j->len;
+	*from = start > j->offset ? start : j->offset;
+	*to = start + EDITOR_JOURNAL_BLOCK < end ? start + EDITOR_JOURNAL_BLOCK : end;
+}
+
+// call fn with each block of the journal as fd holds it now (shorter, or
+// empty, where the file ends inside it), reading a few blocks at a time.
+// Returns -1 if the file can't be read or fn returns -1
+static int editorJournalEach(int fd, struct editorJournal *j,
+		int (*fn)(struct editorJournal *j, uint64_t k, const char *cur, size_t curlen, void *arg),
+		void *arg) {
+	char *buf = memAlloc(MEM_FILEIO, EDITOR_JOURNAL_BLOCK * EDITOR_JOURNAL_READ);
+	int ret = 0;
+	for (uint64_t k = 0; k < j->blocks && ret == 0; k += EDITOR_JOURNAL_READ) {
+		uint64_t n = j->blocks - k < EDITOR_JOURNAL_READ ? j->blocks - k : EDITOR_JOURNAL_READ;
+		uint64_t from, to, last, end;
+		editorJournalBlock(j, k, &from, &to);
+		editorJournalBlock(j, k + n - 1, &last, &end);
+		ssize_t got = preadAll(fd, buf, end - from, from);
+		if (got == -1) {
+			ret = -1;
+			break;
+		}
+		for (uint64_t i = 0; i < n && ret == 0; i++) {
+			uint64_t a, b;
+			editorJournalBlock(j, k + i, &a, &b);
+			a -= from;
+			b -= from;
+			if (b > (uint64_t)got) b = got;
+			if (a > b) a = b;
+			ret = fn(j, k + i, buf + a, b - a, arg);
+		}
+	}
+	memFree(buf);
+	return ret;
+}
+
+static int editorJournalHash(struct editorJournal *j, uint64_t k, const char *cur,
+		size_t curlen, void *arg) {
+	(void)j;
+	((uint64_t *)arg)[k] = fnv1a(FNV_BASIS, cur, curlen);
+	return 0;
+}
+
+struct editorJournalCheck {
+	const uint64_t *hashes;
+	const char *data;
+	uint64_t cur_size;
+};
+
+// whether block k holds the old bytes or the new ones
+static int editorJournalCheckBlock(struct editorJournal *j, uint64_t k, const char *cur,
+		size_t curlen, void *arg) {
+	struct editorJournalCheck *c = arg;
+	uint64_t from, to;
+	editorJournalBlock(j, k, &from, &to);
+	uint64_t old_to = to < j->old_size ? to : j->old_size;
+	if (curlen == (from < old_to ? old_to - from : 0) &&
+			fnv1a(FNV_BASIS, cur, curlen) == c->hashes[k])
+		return 0;
+	// the new bytes, all of them or up to where the file ends for now
+	if ((curlen == to - from || from + curlen == c->cur_size) &&
+			!memcmp(cur, c->data + (from - j->offset), curlen))
+		return 0;
+	return -1;
+}
+
+// whether fd is the file the journal is for, as a save cut short leaves it
+static int editorJournalMatches(int fd, struct editorJournal *j, const uint64_t *hashes,
+		const char *data) {
+	struct stat st;
+	if (fstat(fd, &st) == -1) return 0;
+	if ((uint64_t)st.st_dev != j->dev || (uint64_t)st.st_ino != j->ino) return 0;
+	uint64_t size = st.st_size;
+	uint64_t min = j->old_size < j->size ? j->old_size : j->size;
+	uint64_t max = j->old_size > j->offset + j->len ? j->old_size : j->offset + j->len;
+	if (size < min || size > max) return 0;
+	struct editorJournalCheck c = {hashes, data, size};
+	return editorJournalEach(fd, j, editorJournalCheckBlock, &c) == 0;
+}
+
+static char *editorJournalPath(const char *filename) {
+	size_t len = strlen(filename) + sizeof(".journal");
+	char *path = malloc(len);
+	if (path) snprintf(path, len, "%s.journal", filename);
+	return path;
+}
+
+// fsync the directory path is in, so a file made in it or removed from it
+// stays made or removed
+static int editorSyncDir(const char *path) {
+	const char *slash = strrchr(path, '/');
+	char *dir = slash ? strndup(path, slash == path ? 1 : (size_t)(slash - path)) : strdup(".");
+	int fd = dir ? open(dir, O_RDONLY | O_DIRECTORY) : -1;
+	free(dir);
+	if (fd == -1) return -1;
+	int ret = fsync(fd);
+	close(fd);
+	return ret;
+}
+
+// write data at offset and truncate to size, the journal already being safe
+static int editorJournalApply(int fd, const char *data, size_t len, off_t offset, off_t size) {
+	if (pwriteAll(fd, data, len, offset) == -1) return -1;
+	if (ftruncate(fd, size) == -1) return -1;
+	return fsync(fd);
+}
+
+int editorJournalWrite(const char *filename, int fd, const char *data, size_t len,
+		off_t offset, off_t size) {
+	struct stat st;
+	if (fstat(fd, &st) == -1) return -1;
+	struct editorJournal j;
+	memset(&j, 0, sizeof(j));
+	memcpy(j.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+	j.dev = st.st_dev;
+	j.ino = st.st_ino;
+	j.old_size = st.st_size;
+	j.offset = offset;
+	j.size = size;
+	j.len = len;
+	j.blocks = editorJournalBlocks(offset, len);
+	uint64_t *hashes = memAlloc(MEM_FILEIO, (j.blocks ? j.blocks : 1) * sizeof(*hashes));
+	if (editorJournalEach(fd, &j, editorJournalHash, hashes) == -1) {
+		memFree(hashes);
+		return -1;
+	}
+	j.sum = editorJournalSum(&j, hashes, data);
+
+	char *path = editorJournalPath(filename);
+	int jfd = path ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600) : -1;
+	int ret = jfd == -1 ? -1 : 0;
+	if (ret == 0 && (writeAll(jfd, (char *)&j, sizeof(j)) == -1 ||
+			writeAll(jfd, (char *)hashes, j.blocks * sizeof(*hashes)) == -1 ||
+			writeAll(jfd, data, len) == -1 || fsync(jfd) == -1))
+		ret = -1;
+	if (jfd != -1 && close(jfd) == -1) ret = -1;
+	if (ret == 0) ret = editorSyncDir(path);
+	if (ret == -1 && jfd != -1) {
+		int saved = errno;
+		unlink(path);
+		errno = saved;
+	}
+	memFree(hashes);
+	free(path);
+	return ret;
+}
+
+// remove a journal that's done with
+static void editorJournalRemove(const char *path) {
+	if (unlink(path) == 0) editorSyncDir(path);
+}
+
+int editorRecover(const char *filename) {
+	char *path = editorJournalPath(filename);
+	if (path == NULL) return -1;
+	int jfd = open(path, O_RDONLY);
+	if (jfd == -1) {
+		free(path);
+		return 0;
+	}
+
+	int ret = 0;
+	struct editorJournal j;
+	uint64_t *hashes = NULL;
+	char *data = NULL;
+	struct stat st;
+	if (fstat(jfd, &st) == 0 && (size_t)st.st_size >= sizeof(j) &&
+			readAll(jfd, (char *)&j, sizeof(j)) == 0 &&
+			!memcmp(j.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) &&
+			j.blocks == editorJournalBlocks(j.offset, j.len) &&
+			j.len == (uint64_t)st.st_size - sizeof(j) - j.blocks * sizeof(*hashes) &&
+			(hashes = malloc(j.blocks ? j.blocks * sizeof(*hashes) : 1)) != NULL &&
+			(data = malloc(j.len ? j.len : 1)) != NULL &&
+			readAll(jfd, (char *)hashes, j.blocks * sizeof(*hashes)) == 0 &&
+			readAll(jfd, data, j.len) == 0 && j.sum == editorJournalSum(&j, hashes, data)) {
+		int fd = open(filename, O_RDWR);
+		if (fd == -1) ret = -1;
+		else if (!editorJournalMatches(fd, &j, hashes, data)) ret = 2;
+		else if (editorJournalApply(fd, data, j.len, j.offset, j.size) == -1) ret = -1;
+		else ret = 1;
+		if (fd != -1) close(fd);
+	}
+	free(hashes);
+	free(data);
+	close(jfd);
+	// a journal that couldn't be applied, or isn't for the file as it is,
+	// stays for another try or for the user
+	if (ret == 0 || ret == 1) editorJournalRemove(path);
+	free(path);
+	return ret;
+}
+
+// tell the user what editorRecover did
+static void editorRecoverReport(struct editorConfig *E, int recovered) {
+	if (recovered == 1) editorSetStatusMessage(E, "Finished an interrupted save");
+	else if (recovered == 2)
+		editorSetStatusMessage(E, "%s.journal doesn't match the file (changed since?), left alone",
+			E->filename);
+	else if (recovered == -1)
+		editorSetStatusMessage(E, "Can't finish the interrupted save in %s.journal",
+			E->filename);
+}
+
+/*** open and save ***/
 
-	editorSelectSyntaxHighlight();
+// the file on disk now matches the rows
+static void editorSaveSync(struct editorConfig *E, struct stat *st, int exact) {
+	E->save.exact = exact;
+	E->save.dev = st->st_dev;
+	E->save.ino = st->st_ino;
+	E->save.size = st->st_size;
+	E->save.mtime = st->st_mtim;
+	E->save.first = 1;
+	E->save.last = 0;
+	E->dirty = 0;
+	editorDiffSynced(E);
+}
+
+// whether st is the file as the rows were last synced with it
+static int editorSaveMatches(struct editorConfig *E, struct stat *st) {
+	struct editorSaveState *s = &E->save;
+	return st->st_dev == s->dev && st->st_ino == s->ino && st->st_size == s->size &&
+		st->st_mtim.tv_sec == s->mtime.tv_sec && st->st_mtim.tv_nsec == s->mtime.tv_nsec;
+}
+
+int editorDiskChanged(struct editorConfig *E) {
+	struct stat st;
+	if (E->filename == NULL || stat(E->filename, &st) == -1) return -1;
+	return !editorSaveMatches(E, &st);
+}
+
+/*** session cache ***/
+
+// a file of at least EDITOR_SESSION_MIN_SIZE bytes leaves a session cache
+// in "<file>.session" when the editor quits, so opening it again skips
+// the newline scan, rendering and lexing. It's laid out to be mapped and
+// used in place:
+//
+//   struct editorSessionHeader, the file's real path (padded to 8 bytes),
+//   uint64_t offsets[rows + 1] where each row starts (then the size),
+//   int32_t brackets[rows][3] (each row's struct bracketSummary) and
+//   uint8_t states[rows] (hl_open_comment), padded to 8 bytes
+//
+// It's only written for a file the rows are in sync with and that saving
+// them gives back exactly (every line ends in '\n', no '\r'), and only
+// used while the file has the size, mtime and inode it was written for,
+// the syntax picked for it lexes the same way and the sum checks out
+
+#define SESSION_MAGIC "wesess1"
+
+struct editorSessionHeader {
+	char magic[8];
+	uint64_t dev, ino, size, mtime_sec, mtime_nsec; // the file it's for
+	uint64_t syntax; // sessionSyntax of the syntax it was lexed with
+	uint64_t rows;
+	uint64_t cy, cx, rowoff, coloff;
+	uint64_t pathlen;
+	uint64_t sum; // of everything after the header, see sessionSum
+};
+
+static char *editorSessionPath(const char *filename) {
+	size_t len = strlen(filename) + sizeof(".session");
+	char *path = malloc(len);
+	if (path) snprintf(path, len, "%s.session", filename);
+	return path;
+}
+
+static size_t sessionPad(size_t n) {
+	return (n + 7) & ~(size_t)7;
+}
+
+// bytes after the header
+static size_t sessionDataLen(uint64_t pathlen, uint64_t rows) {
+	return sessionPad(pathlen) + sizeof(uint64_t) * (rows + 1) +
+		sessionPad((sizeof(int32_t) * 3 + 1) * rows);
+}
+
+// FNV-1a a word at a time, the data being padded to 8 bytes
+static uint64_t sessionSum(const unsigned char *p, size_t len) {
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i += 8) {
+		uint64_t w;
+		memcpy(&w, p + i, sizeof(w));
+		h = (h ^ w) * 1099511628211ULL;
+	}
+	return h;
+}
+
+// what exit states and bracket summaries depend on, 0 for no syntax
+static uint64_t sessionSyntax(struct editorSyntax *s) {
+	if (s == NULL) return 0;
+	const char *parts[] = { s->filetype, s->singleline_comment_start,
+		s->multiline_comment_start, s->multiline_comment_end };
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t k = 0; k < sizeof(parts) / sizeof(parts[0]); k++) {
+		const char *part = parts[k] ? parts[k] : "";
+		h = fnv1a(h, part, strlen(part) + 1);
+	}
+	h = fnv1a(h, &s->flags, sizeof(s->flags));
+	return h ? h : 1;
+}
 
+int editorSessionSave(struct editorConfig *E) {
+	struct editorSaveState *s = &E->save;
+	if (E->filename == NULL || E->follow || E->dirty || !s->exact ||
+			s->size < EDITOR_SESSION_MIN_SIZE || editorDiskChanged(E) != 0)
+		return -1;
+	char *path = realpath(E->filename, NULL);
+	char *session = editorSessionPath(E->filename);
+	if (path == NULL || session == NULL) {
+		free(path);
+		free(session);
+		return -1;
+	}
+
+	struct editorSessionHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, SESSION_MAGIC, sizeof(SESSION_MAGIC));
+	h.dev = s->dev;
+	h.ino = s->ino;
+	h.size = s->size;
+	h.mtime_sec = s->mtime.tv_sec;
+	h.mtime_nsec = s->mtime.tv_nsec;
+	h.syntax = sessionSyntax(E->syntax);
+	h.rows = E->numrows;
+	h.cy = E->cy;
+	h.cx = E->cx;
+	h.rowoff = E->rowoff;
+	h.coloff = E->coloff;
+	h.pathlen = strlen(path);
+
+	size_t datalen = sessionDataLen(h.pathlen, h.rows);
+	unsigned char *data = memAlloc(MEM_FILEIO, datalen);
+	memset(data, 0, datalen);
+	memcpy(data, path, h.pathlen);
+	uint64_t *offsets = (uint64_t *)(data + sessionPad(h.pathlen));
+	int32_t *brackets = (int32_t *)(offsets + h.rows + 1);
+	uint8_t *states = (uint8_t *)(brackets + 3 * h.rows);
+	uint64_t at = 0;
+	for (size_t j = 0; j < E->numrows; j++) {
+		erow *row = &E->row[j];
+		offsets[j] = at;
+		at += row->size + 1;
+		brackets[3 * j] = row->brackets.delta;
+		brackets[3 * j + 1] = row->brackets.min;
+		brackets[3 * j + 2] = row->brackets.max;
+		states[j] = row->hl_open_comment != 0;
+	}
+	offsets[h.rows] = at;
+	h.sum = sessionSum(data, datalen);
+
+	// written aside and renamed, so it's never seen half written
+	int ret = -1;
+	size_t tmplen = strlen(session) + sizeof(".tmp");
+	char *tmp = malloc(tmplen);
+	snprintf(tmp, tmplen, "%s.tmp", session);
+	int fd = at == h.size ? open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600) : -1;
+	if (fd != -1) {
+		if (writeAll(fd, (char *)&h, sizeof(h)) == 0 && writeAll(fd, (char *)data, datalen) == 0 &&
+				close(fd) == 0 && rename(tmp, session) == 0)
+			ret = 0;
+		else
+			unlink(tmp);
+	}
+	free(tmp);
+	memFree(data);
+	free(session);
+	free(path);
+	return ret;
+}
+
+// whether a mapped session cache of len bytes is for the file open as st
+static int editorSessionValid(struct editorConfig *E, const unsigned char *map, size_t len,
+		struct stat *st) {
+	const struct editorSessionHeader *h = (const struct editorSessionHeader *)map;
+	if (len < sizeof(*h) || memcmp(h->magic, SESSION_MAGIC, sizeof(SESSION_MAGIC)) ||
+			h->dev != (uint64_t)st->st_dev || h->ino != (uint64_t)st->st_ino ||
+			h->size != (uint64_t)st->st_size || h->mtime_sec != (uint64_t)st->st_mtim.tv_sec ||
+			h->mtime_nsec != (uint64_t)st->st_mtim.tv_nsec)
+		return 0;
+	// every row takes a byte at least, so this can't overflow
+	if (h->rows > h->size || h->pathlen > len ||
+			sessionDataLen(h->pathlen, h->rows) != len - sizeof(*h))
+		return 0;
+	char *path = realpath(E->filename, NULL);
+	int valid = path && strlen(path) == h->pathlen && !memcmp(map + sizeof(*h), path, h->pathlen) &&
+		h->syntax == sessionSyntax(E->syntax) && h->sum == sessionSum(map + sizeof(*h), len - sizeof(*h));
+	free(path);
+	return valid;
+}
+
+// load the rows of the file in buf from a valid session cache: the rows
+// around where the view was are rendered and lexed, the rest go straight
+// into cold blocks. Returns -1 if the line offsets don't fit the file
+static int editorSessionLoad(struct editorConfig *E, const unsigned char *map, char *buf) {
+	const struct editorSessionHeader *h = (const struct editorSessionHeader *)map;
+	const uint64_t *offsets = (const uint64_t *)(map + sizeof(*h) + sessionPad(h->pathlen));
+	const int32_t *brackets = (const int32_t *)(offsets + h->rows + 1);
+	const uint8_t *states = (const uint8_t *)(brackets + 3 * h->rows);
+	size_t rows = h->rows;
+
+	// each row ends in a newline, which goes to make the null byte after
+	// its chars in a cold block
+	size_t *bytes = malloc(sizeof(size_t) * (rows ? rows : 1));
+	if (offsets[0] != 0 || offsets[rows] != h->size) {
+		free(bytes);
+		return -1;
+	}
+	for (size_t j = 0; j < rows; j++) {
+		if (offsets[j + 1] <= offsets[j] || offsets[j + 1] > h->size ||
+				buf[offsets[j + 1] - 1] != '\n') {
+			free(bytes);
+			return -1;
+		}
+		bytes[j] = offsets[j + 1] - offsets[j];
+	}
+	for (size_t j = 0; j < rows; j++) buf[offsets[j + 1] - 1] = '\0';
+	editorLoadRowsBare(E, bytes, rows);
+	free(bytes);
+	for (size_t j = 0; j < rows; j++) {
+		erow *row = &E->row[j];
+		row->hl_open_comment = states[j];
+		row->brackets.delta = brackets[3 * j];
+		row->brackets.min = brackets[3 * j + 1];
+		row->brackets.max = brackets[3 * j + 2];
+	}
+	editorBracketsRows(E, 0, rows);
+
+	E->cy = h->cy < rows ? h->cy : rows;
+	E->rowoff = h->rowoff <= E->cy ? h->rowoff : E->cy;
+	E->cx = E->cy < rows && h->cx <= E->row[E->cy].size ? h->cx : 0;
+	E->coloff = h->coloff;
+
+	// the screen and the cursor's row are painted right away, long rows
+	// are never cold. Runs of the others make blocks
+	size_t top = E->rowoff, bottom = E->rowoff + E->screenrows;
+	for (size_t j = 0; j < rows; ) {
+		size_t from = j, raw = 0;
+		while (j < rows && (j < top || j >= bottom) && j != E->cy &&
+				E->row[j].size < EDITOR_LONG_ROW / 2 && raw < EDITOR_COLD_BLOCK)
+			raw += E->row[j++].size + 1;
+		if (j > from) {
+			editorColdLoad(E, from, j, buf + offsets[from]);
+			continue;
+		}
+		erow *row = &E->row[j++];
+		row->chars = memAlloc(MEM_CHARS, row->size + 1);
+		memcpy(row->chars, buf + offsets[row->idx], row->size + 1);
+	}
+	for (size_t j = 0; j < rows; j++)
+		if (E->row[j].cold == NULL) editorRowRestore(E, &E->row[j]);
+	return 0;
+}
+
+int editorSessionOpen(struct editorConfig *E) {
+	int fd = open(E->filename, O_RDONLY);
+	if (fd == -1) return -1;
+	struct stat st, sst;
+	char *session = editorSessionPath(E->filename);
+	int sfd = -1;
+	if (fstat(fd, &st) == -1 || st.st_size < EDITOR_SESSION_MIN_SIZE || session == NULL ||
+			(sfd = open(session, O_RDONLY)) == -1 || fstat(sfd, &sst) == -1 || sst.st_size == 0) {
+		if (sfd != -1) close(sfd);
+		free(session);
+		close(fd);
+		return -1;
+	}
+	free(session);
+	size_t len = sst.st_size;
+	unsigned char *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, sfd, 0);
+	close(sfd);
+	if (map == MAP_FAILED) {
+		close(fd);
+		return -1;
+	}
+
+	int ret = -1;
+	editorSelectSyntax(E);
+	if (editorSessionValid(E, map, len, &st)) {
+		char *buf = memAlloc(MEM_FILEIO, st.st_size);
+		if (readAll(fd, buf, st.st_size) == 0 && editorSessionLoad(E, map, buf) == 0) {
+			editorSaveSync(E, &st, 1);
+			ret = 0;
+		}
+		memFree(buf);
+	}
+	munmap(map, len);
+	close(fd);
+	return ret;
+}
+
+int editorOpen(struct editorConfig *E, char *filename) {
+	free(E->filename); // strdup assumes you will free the memory
+	E->filename = strdup(filename);
+
+	int recovered = editorRecover(filename);
+	if (recovered != 1 && editorSessionOpen(E) == 0) {
+		editorWatchStart(E);
+		editorRecoverReport(E, recovered);
+		return 0;
+	}
   FILE *fp = fopen(filename, "r");
-  if (!fp) die("fopen");
+  if (!fp) return -1;
+  // whether saving the rows gives back the same bytes
+  int exact = 1;
   char *line = NULL;
   size_t linecap = 0;
   ssize_t linelen;
   while ((linelen = getline(&line, &linecap, fp)) != -1) {
+    if (line[linelen - 1] != '\n') exact = 0;
     while (linelen > 0 && (line[linelen - 1] == '\n' ||
                            line[linelen - 1] == '\r'))
       linelen--;
-    editorInsertRow(E.numrows, line, linelen);
+    if (line[linelen] == '\r') exact = 0;
+    editorLoadRow(E, line, linelen);
   }
   free(line);
+	struct stat st;
+	if (fstat(fileno(fp), &st) == 0) editorSaveSync(E, &st, exact);
   fclose(fp);
-	E.dirty = 0;
+	// highlight everything in one go (in parallel for big files)
+	// instead of row by row as they're read
+	editorSelectSyntaxHighlight(E);
+	E->dirty = 0;
+	editorRecoverReport(E, recovered);
+	editorWatchStart(E);
+	return 0;
+}
+
+size_t editorLoadLines(struct editorConfig *E, const char *buf, size_t len, int *exact) {
+	size_t lines = 0;
+	const char *p = buf, *end = buf + len;
+	while (p < end) {
+		const char *nl = memchr(p, '\n', end - p);
+		if (nl == NULL) {
+			nl = end;
+			*exact = 0;
+		}
+		size_t linelen = nl - p;
+		while (linelen > 0 && p[linelen - 1] == '\r') linelen--;
+		if (p + linelen != nl) *exact = 0;
+		editorLoadRow(E, (char *)p, linelen);
+		p = nl + 1;
+		lines++;
+	}
+	return lines;
 }
 
-void editorSave() {
-	if (E.filename == NULL) {
-		E.filename = editorPrompt("Save as: %s (ESC to cancel)", NULL);
-		if (E.filename == NULL) {
-			editorSetStatusMessage("Save aborted");
-			return;
+int editorOpenProgressive(struct editorConfig *E, char *filename) {
+	free(E->filename);
+	E->filename = strdup(filename);
+
+	int recovered = editorRecover(filename);
+	if (recovered != 1 && editorSessionOpen(E) == 0) {
+		editorWatchStart(E);
+		editorRecoverReport(E, recovered);
+		return 0;
+	}
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1) return -1;
+
+	// read until there's a screenful of lines, used is where it ends
+	size_t cap = EDITOR_FOLLOW_READ, len = 0, lines = 0, used = 0;
+	char *buf = memAlloc(MEM_FILEIO, cap);
+	ssize_t n;
+	while (lines < (size_t)E->screenrows && (n = read(fd, buf + len, cap - len)) != 0) {
+		if (n == -1) {
+			if (errno == EINTR) continue;
+			memFree(buf);
+			close(fd);
+			return -1;
 		}
-		editorSelectSyntaxHighlight();
+		len += n;
+		for (; used < len && lines < (size_t)E->screenrows; used++) lines += buf[used] == '\n';
+		if (len == cap) buf = memRealloc(MEM_FILEIO, buf, cap *= 2);
 	}
 
-	int len;
-	char *buf = editorRowsToString(&len);
-	// create new file if it doesn't exist and open it with read/write
+	int exact = 1;
+	if (lines < (size_t)E->screenrows) {
+		// that was all of it
+		editorLoadLines(E, buf, len, &exact);
+		memFree(buf);
+		editorSelectSyntaxHighlight(E);
+		editorLoadFinished(E, fd, exact);
+		close(fd);
+		editorRecoverReport(E, recovered);
+		return 0;
+	}
+
+	// the rest of what was read comes in with everything after it
+	editorLoadLines(E, buf, used, &exact);
+	editorSelectSyntaxHighlight(E);
+	int ret = editorFollowLoad(E, fd, buf + used, len - used, exact);
+	memFree(buf);
+	if (ret == -1) {
+		close(fd);
+		return -1;
+	}
+	editorRecoverReport(E, recovered);
+	return 0;
+}
+
+void editorLoadFinished(struct editorConfig *E, int fd, int exact) {
+	// keep whatever was changed while the rest of the file came in
+	size_t dirty = E->dirty;
+	size_t first = E->save.first, last = E->save.last;
+	struct stat st;
+	if (fstat(fd, &st) == 0) editorSaveSync(E, &st, exact);
+	E->dirty = dirty;
+	E->save.first = first;
+	E->save.last = last;
+	editorWatchStart(E);
+}
+
+int editorOpenFollow(struct editorConfig *E, char *filename) {
+	int fd = STDIN_FILENO;
+	if (filename) {
+		fd = open(filename, O_RDONLY);
+		if (fd == -1) return -1;
+	}
+	free(E->filename);
+	E->filename = filename ? strdup(filename) : NULL;
+	editorSelectSyntaxHighlight(E);
+	if (editorFollowStart(E, fd) == -1) {
+		if (filename) close(fd);
+		return -1;
+	}
+	return 0;
+}
+
+int editorReload(struct editorConfig *E) {
+	int fd = open(E->filename, O_RDONLY);
+	if (fd == -1) return -1;
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return -1;
+	}
+	// the file may still be growing, read whatever is there
+	size_t cap = st.st_size + 1, len = 0;
+	char *buf = memAlloc(MEM_FILEIO, cap);
+	ssize_t n;
+	while ((n = read(fd, buf + len, cap - len)) != 0) {
+		if (n == -1) {
+			if (errno == EINTR) continue;
+			memFree(buf);
+			close(fd);
+			return -1;
+		}
+		len += n;
+		if (len == cap) buf = memRealloc(MEM_FILEIO, buf, cap *= 2);
+	}
+	if (fstat(fd, &st) == -1) st.st_size = -1;
+	close(fd);
+
+	// split into lines the way editorOpen reads them
+	size_t nlines = 0, linecap = 1024;
+	char **lines = malloc(sizeof(char *) * linecap);
+	size_t *lens = malloc(sizeof(size_t) * linecap);
+	int exact = 1;
+	for (size_t i = 0; i < len; ) {
+		char *nl = memchr(buf + i, '\n', len - i);
+		size_t end = nl ? (size_t)(nl - buf) : len;
+		if (nl == NULL) exact = 0;
+		size_t linelen = end - i;
+		while (linelen > 0 && buf[i + linelen - 1] == '\r') linelen--;
+		if (linelen < end - i) exact = 0;
+		if (nlines == linecap) {
+			linecap *= 2;
+			lines = realloc(lines, sizeof(char *) * linecap);
+			lens = realloc(lens, sizeof(size_t) * linecap);
+		}
+		lines[nlines] = buf + i;
+		lens[nlines++] = linelen;
+		i = end + 1;
+	}
+
+	// only the rows between the unchanged head and tail are replaced
+	size_t head = 0, tail = 0;
+	while (head < E->numrows && head < nlines && E->row[head].size == lens[head] &&
+			!memcmp(editorColdChars(E, &E->row[head]), lines[head], lens[head]))
+		head++;
+	while (tail < E->numrows - head && tail < nlines - head) {
+		erow *row = &E->row[E->numrows - 1 - tail];
+		size_t j = nlines - 1 - tail;
+		if (row->size != lens[j] || memcmp(editorColdChars(E, row), lines[j], lens[j])) break;
+		tail++;
+	}
+	size_t del = E->numrows - head - tail;
+	size_t count = nlines - head - tail;
+	if (del || count) editorReplaceRows(E, head, del, &lines[head], &lens[head], count);
+	free(lines);
+	free(lens);
+	memFree(buf);
+
+	// keep the cursor and the view on the same text
+	if (E->cy >= head + del) E->cy += count - del;
+	else if (E->cy > head + count) E->cy = head + count;
+	if (E->rowoff >= head + del) E->rowoff += count - del;
+	if (E->cy > E->numrows) E->cy = E->numrows;
+	if (E->rowoff > E->cy) E->rowoff = E->cy;
+	if (E->cy == E->numrows) E->cx = 0;
+	else if (E->cx > E->row[E->cy].size) E->cx = E->row[E->cy].size;
+
+	editorSaveSync(E, &st, exact && st.st_size == (off_t)len);
+	editorSetStatusMessage(E, "Reloaded from disk (+%zu -%zu lines)", count, del);
+	return 0;
+}
+
+// write len bytes at offset and truncate to size, through the journal so
+// a crash half way is rolled forward on the next open. If the journal
+// can't be made (say the disk is full) the file isn't touched and the save
+// fails with -2, its status message already set
+static int editorSaveWrite(struct editorConfig *E, int fd, const char *buf, size_t len,
+		off_t offset, off_t size) {
+	if (editorJournalWrite(E->filename, fd, buf, len, offset, size) == -1) {
+		editorSetStatusMessage(E, "Can't save! Can't write %s.journal: %s", E->filename,
+			strerror(errno));
+		return -2;
+	}
+	int ret = editorJournalApply(fd, buf, len, offset, size);
+	// a journal that couldn't be applied stays for editorRecover
+	if (ret == 0) {
+		char *journal = editorJournalPath(E->filename);
+		if (journal) editorJournalRemove(journal);
+		free(journal);
+	}
+	return ret;
+}
+
+// write the whole file in place from the start. Writing into the file
+// itself (not a copy renamed over it) keeps symlinks, hard links, owner
+// and mode as they are
+static int editorSaveFull(struct editorConfig *E, size_t *written) {
+	size_t len;
+	char *buf = editorRowsToString(E, &len);
 	// 0644 is standard permissions for file - owner read/write everyone else read
-	int fd = open(E.filename, O_RDWR | O_CREAT, 0644);
+	int fd = open(E->filename, O_RDWR | O_CREAT, 0644);
+	int ret = -1;
 	if (fd != -1) {
-		if (ftruncate(fd, len) != -1) {
-			if (write(fd, buf, len) == len) {
-				close(fd);
-				free(buf);
-				E.dirty = 0;
-				editorSetStatusMessage("%d bytes written to disk", len);
-				return;
-			}
+		struct stat st;
+		ret = editorSaveWrite(E, fd, buf, len, 0, len);
+		if (ret == 0 && fstat(fd, &st) == -1) ret = -1;
+		if (ret == 0) {
+			editorSaveSync(E, &st, 1);
+			*written = len;
 		}
 		close(fd);
 	}
-	free(buf);
-	editorSetStatusMessage("Can't save! I/O error: %s", strerror(errno));
-}
\ No newline at end of file
+	memFree(buf);
+	return ret;
+}
+
+// write only what changed since the file was last read or written: the
+// changed rows in place if the file keeps its size, or everything from the
+// first changed row on. Returns 1 if the file isn't the one the rows were
+// last synced with (so only a full save will do)
+static int editorSavePartial(struct editorConfig *E, size_t *written) {
+	struct editorSaveState *s = &E->save;
+	if (!s->exact) return 1;
+	int fd = open(E->filename, O_RDWR);
+	if (fd == -1) return 1;
+	struct stat st;
+	if (fstat(fd, &st) == -1 || !editorSaveMatches(E, &st)) {
+		close(fd);
+		return 1;
+	}
+
+	size_t size = editorRowOffset(E, E->numrows);
+	size_t from = s->first, to = s->last + 1;
+	if (s->first > s->last) from = to = E->numrows;
+	if (to > E->numrows) to = E->numrows;
+	// rows after the changed ones are where they were unless the size changed
+	if (size != (size_t)s->size) to = E->numrows;
+	if (from > to) from = to;
+
+	size_t len;
+	char *buf = editorRowsRange(E, from, to, &len);
+	off_t offset = editorRowOffset(E, from);
+	int ret = 0;
+	// nothing to do if nothing changed
+	if (len > 0 || size != (size_t)s->size) ret = editorSaveWrite(E, fd, buf, len, offset, size);
+	if (ret == 0 && fstat(fd, &st) == 0) {
+		editorSaveSync(E, &st, 1);
+		*written = len;
+	}
+	close(fd);
+	memFree(buf);
+	return ret;
+}
+
+int editorSave(struct editorConfig *E) {
+	if (E->filename == NULL) {
+		errno = EINVAL;
+		editorSetStatusMessage(E, "Can't save! No file name");
+		return -1;
+	}
+
+	// all of the file has to be in before any of it is written
+	editorFollowWaitRows(E, SIZE_MAX);
+	size_t written = 0;
+	int ret = editorSavePartial(E, &written);
+	if (ret == 1) ret = editorSaveFull(E, &written);
+	if (ret == 0) {
+		editorSetStatusMessage(E, "%zu bytes written to disk", written);
+		return 0;
+	}
+	if (ret == -2) return -1;
+	editorSetStatusMessage(E, "Can't save! I/O error: %s", strerror(errno));
+	return -1;
+}
@@ -1,13 +1,70 @@
 #ifndef __FILEIO_H__
 #define __FILEIO_H__
 
+#include "structs.h"
+
 // convert all rows to a string ready to be written to a file
-void *editorRowsToString(int *buflen);
+// (release it with memFree)
+void *editorRowsToString(struct editorConfig *E, size_t *buflen);
+
+// write "<filename>.journal" for a save of len bytes of data at offset
+// that truncates the file (open as fd) to size, see fileio.c. editorSave
+// does this before it touches the file. Returns -1 (with errno set) on
+// failure
+int editorJournalWrite(const char *filename, int fd, const char *data, size_t len,
+		off_t offset, off_t size);
+
+// finish a save of filename that was cut short, see fileio.c. Returns 1
+// if there was one, 0 if not, 2 if its journal doesn't match the file
+// (which is left alone, as is the journal) and -1 if it couldn't be
+// finished
+int editorRecover(const char *filename);
+
+// open a file for reading, returns -1 (with errno set) on failure
+int editorOpen(struct editorConfig *E, char *filename);
+
+// open E->filename from its session cache (see fileio.c) if it has one
+// that still matches it: the rows go straight into cold blocks (see
+// cold.h) with their exit states, and only the rows on screen where the
+// view was are rendered and lexed. Returns 0 if it did, -1 if not (the
+// rows are left as they were)
+int editorSessionOpen(struct editorConfig *E);
+
+// write the session cache of E->filename, if the rows are in sync with it
+// and it's big enough to be worth one. Returns -1 if it isn't written
+int editorSessionSave(struct editorConfig *E);
+
+// open a file, loading and highlighting its first screenful of lines
+// right away and the rest from a background reader (see
+// editorFollowLoad), so the first frame doesn't wait for the whole file.
+// Returns -1 (with errno set) on failure
+int editorOpenProgressive(struct editorConfig *E, char *filename);
+
+// append the lines in buf (the last one may lack its '\n') as loaded
+// rows, clearing *exact if saving them wouldn't give back the same bytes.
+// Returns the number of lines
+size_t editorLoadLines(struct editorConfig *E, const char *buf, size_t len, int *exact);
+
+// the rows now hold all of the file open as fd: remember it as synced
+// (keeping changes made in the meantime) and start watching it
+void editorLoadFinished(struct editorConfig *E, int fd, int exact);
+
+// open a file (stdin if filename is NULL) in follow mode, see follow.h.
+// Its lines arrive from the main loop, the file isn't watched for
+// rewrites. Returns -1 (with errno set) on failure
+int editorOpenFollow(struct editorConfig *E, char *filename);
+
+// re-read E->filename, replacing only the rows that differ and keeping
+// the cursor on the same text. Returns -1 (with errno set) on failure
+int editorReload(struct editorConfig *E);
 
-// open a file for reading
-void editorOpen(char *filename);
+// whether E->filename on disk is no longer the file as it was last read or
+// written, -1 if it can't be looked at
+int editorDiskChanged(struct editorConfig *E);
 
-// write a string to disk
-void editorSave();
+// write the rows to E->filename, only the changed ones if the file is
+// still as it was read or last written. Returns -1 on failure
+// (the outcome is also reported in the status message)
+int editorSave(struct editorConfig *E);
 
-#endif
\ No newline at end of file
+#endif
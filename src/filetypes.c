@@ -1,6 +1,12 @@
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "filetypes.h"
 #include "structs.h"
 #include "constants.h"
+#include "lexer.h"
 
 char *C_HL_extensions[] = { ".c", ".h", ".cpp", NULL };
 char *C_HL_keywords[] = {
@@ -16,8 +22,133 @@ struct editorSyntax HLDB[] = {
 		C_HL_extensions,
 		C_HL_keywords,
 		"//", "/*", "*/",
-		HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS
+		HL_HIGHLIGHT_NUMBERS | HL_HIGHLIGHT_STRINGS,
+		NULL
 	},
 };
 
-unsigned int HLDB_ENTRIES = sizeof(HLDB) / sizeof(HLDB[0]);
\ No newline at end of file
+unsigned int HLDB_ENTRIES = sizeof(HLDB) / sizeof(HLDB[0]);
+
+// syntax definitions loaded from data files
+static struct editorSyntax **loaded;
+static size_t nloaded;
+
+static pthread_once_t syntax_once = PTHREAD_ONCE_INIT;
+
+// append s to a NULL terminated array of strings
+static char **editorSyntaxPush(char **list, char *s) {
+	size_t n = 0;
+	while (list && list[n]) n++;
+	char **grown = realloc(list, sizeof(char *) * (n + 2));
+	if (grown == NULL) return list;
+	grown[n] = s;
+	grown[n + 1] = NULL;
+	return grown;
+}
+
+int editorSyntaxLoadFile(const char *path) {
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) return -1;
+
+	struct editorSyntax *s = calloc(1, sizeof(struct editorSyntax));
+	if (s == NULL) {
+		fclose(fp);
+		return -1;
+	}
+	char *line = NULL;
+	size_t linecap = 0;
+	while (getline(&line, &linecap, fp) != -1) {
+		char *save;
+		char *key = strtok_r(line, " \t\r\n", &save);
+		if (key == NULL || key[0] == '#') continue;
+		char *val;
+		while ((val = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+			if (!strcmp(key, "filetype")) {
+				free(s->filetype);
+				s->filetype = strdup(val);
+			} else if (!strcmp(key, "filematch")) {
+				s->filematch = editorSyntaxPush(s->filematch, strdup(val));
+			} else if (!strcmp(key, "keywords")) {
+				s->keywords = editorSyntaxPush(s->keywords, strdup(val));
+			} else if (!strcmp(key, "types")) {
+				// secondary keywords carry a trailing '|' like C_HL_keywords
+				char *kw = malloc(strlen(val) + 2);
+				if (kw) sprintf(kw, "%s|", val);
+				s->keywords = editorSyntaxPush(s->keywords, kw);
+			} else if (!strcmp(key, "comment")) {
+				free(s->singleline_comment_start);
+				s->singleline_comment_start = strdup(val);
+			} else if (!strcmp(key, "multiline_comment")) {
+				if (s->multiline_comment_start == NULL) {
+					s->multiline_comment_start = strdup(val);
+				} else {
+					free(s->multiline_comment_end);
+					s->multiline_comment_end = strdup(val);
+				}
+			} else if (!strcmp(key, "flags")) {
+				if (!strcmp(val, "numbers")) s->flags |= HL_HIGHLIGHT_NUMBERS;
+				else if (!strcmp(val, "strings")) s->flags |= HL_HIGHLIGHT_STRINGS;
+			}
+		}
+	}
+	free(line);
+	fclose(fp);
+
+	if (s->filetype == NULL || s->filematch == NULL) goto fail;
+	if (s->keywords == NULL) s->keywords = editorSyntaxPush(NULL, NULL);
+	s->lexer = lexerCompile(s);
+	if (s->lexer == NULL) goto fail;
+
+	struct editorSyntax **grown = realloc(loaded, sizeof(*loaded) * (nloaded + 1));
+	if (grown == NULL) goto fail;
+	loaded = grown;
+	loaded[nloaded++] = s;
+	return 0;
+
+fail:
+	lexerFree(s->lexer);
+	for (size_t j = 0; s->filematch && s->filematch[j]; j++) free(s->filematch[j]);
+	for (size_t j = 0; s->keywords && s->keywords[j]; j++) free(s->keywords[j]);
+	free(s->filematch);
+	free(s->keywords);
+	free(s->filetype);
+	free(s->singleline_comment_start);
+	free(s->multiline_comment_start);
+	free(s->multiline_comment_end);
+	free(s);
+	return -1;
+}
+
+static void editorSyntaxLoadAll() {
+	for (unsigned int j = 0; j < HLDB_ENTRIES; j++)
+		HLDB[j].lexer = lexerCompile(&HLDB[j]);
+
+	char dir[4096];
+	char *env = getenv("WASM_EDITOR_SYNTAX_DIR");
+	char *home = getenv("HOME");
+	if (env && env[0]) snprintf(dir, sizeof(dir), "%s", env);
+	else if (home) snprintf(dir, sizeof(dir), "%s/.wasm-editor/syntax", home);
+	else return;
+
+	DIR *d = opendir(dir);
+	if (d == NULL) return;
+	struct dirent *ent;
+	while ((ent = readdir(d)) != NULL) {
+		size_t len = strlen(ent->d_name);
+		if (len < 7 || strcmp(&ent->d_name[len - 7], ".syntax")) continue;
+		char path[4096 + 256];
+		snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+		editorSyntaxLoadFile(path);
+	}
+	closedir(d);
+}
+
+size_t editorSyntaxCount() {
+	pthread_once(&syntax_once, editorSyntaxLoadAll);
+	return nloaded + HLDB_ENTRIES;
+}
+
+struct editorSyntax *editorSyntaxAt(size_t i) {
+	if (i < nloaded) return loaded[i];
+	return &HLDB[i - nloaded];
+}
@@ -15,4 +15,26 @@ extern struct editorSyntax HLDB[];
 // store the length of the HLDB array
 extern unsigned int HLDB_ENTRIES;
 
-#endif
\ No newline at end of file
+// number of known syntax definitions: the ones loaded from data files
+// followed by the built-in HLDB. The first call loads every *.syntax file
+// in $WASM_EDITOR_SYNTAX_DIR (default ~/.wasm-editor/syntax) and compiles
+// all lexers
+size_t editorSyntaxCount();
+
+// syntax definition i (data files first, so they can override built-ins)
+struct editorSyntax *editorSyntaxAt(size_t i);
+
+// load and compile a syntax definition file, returns -1 if it can't be
+// read or is missing its filetype/filematch lines. Lines look like
+//
+//   # comment
+//   filetype python
+//   filematch .py
+//   keywords if else while
+//   types int str
+//   comment #
+//   multiline_comment """ """
+//   flags numbers strings
+int editorSyntaxLoadFile(const char *path);
+
+#endif
@@ -1,79 +1,178 @@
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "find.h"
 #include "row.h"
-#include "input.h"
 #include "enums.h"
+#include "memory.h"
+#include "cold.h"
+#include "intern.h"
+#include "follow.h"
 
-void editorFindCallback(char *query, int key) {
+void editorFindCallback(struct editorConfig *E, char *query, int key) {
 	// use these to search forward and backward
-	static int last_match = -1;
-	static int direction = 1;
+	struct editorFindState *f = &E->find;
 
-	static int saved_hl_line;
-	static char *saved_hl = NULL;
-
-	if (saved_hl) {
-		memcpy(E.row[saved_hl_line].hl, saved_hl, E.row[saved_hl_line].rsize);
-		free(saved_hl);
-		saved_hl = NULL;
+	if (f->saved_hl) {
+		editorColdThaw(E, &E->row[f->saved_hl_line]);
+		memcpy(E->row[f->saved_hl_line].hl, f->saved_hl, E->row[f->saved_hl_line].rsize);
+		memFree(f->saved_hl);
+		f->saved_hl = NULL;
 	}
 
 	if (key == '\r' || key == '\x1b') {
-		last_match = -1;
-		direction = 1;
+		f->last_match = -1;
+		f->direction = 1;
 		return;
 	} else if (key == ARROW_RIGHT || key == ARROW_DOWN) {
-		direction = 1;
+		f->direction = 1;
 	} else if (key == ARROW_LEFT || key == ARROW_UP) {
-		direction = -1;
+		f->direction = -1;
 	} else {
-		last_match = -1;
-		direction = 1;
+		f->last_match = -1;
+		f->direction = 1;
 	}
 
-	if (last_match == -1) direction = 1;
-	int current = last_match;
-	int i;
-	for (i = 0; i < E.numrows; i++) {
-		current += direction;
-		if (current == -1) current = E.numrows - 1;
-		else if (current == E.numrows) current = 0;
+	if (f->last_match == -1) f->direction = 1;
+	ssize_t current = f->last_match;
+	size_t i;
+	for (i = 0; i < E->numrows; i++) {
+		current += f->direction;
+		if (current == -1) current = E->numrows - 1;
+		else if (current == (ssize_t)E->numrows) current = 0;
 
-		erow *row = &E.row[current];
-		char *match = strstr(row->render, query);
-		if (match) {
-			last_match = current;
-			E.cy = current;
-			E.cx = editorRowRxToCx(row, match - row->render);
-			E.rowoff = E.numrows;
+		erow *row = &E->row[current];
+		// a cold row is only thawed if it matches
+		if (row->cold) {
+			if (strstr(editorColdChars(E, row), query) == NULL) continue;
+			editorColdThaw(E, row);
+		}
+		// chars, like editorReplaceAll, so what's found is what gets replaced
+		char *match = strstr(row->chars, query);
+		if (match == NULL) continue;
+		f->last_match = current;
+		E->cy = current;
+		E->cx = match - row->chars;
+		E->rowoff = E->numrows;
 
-			saved_hl_line = current;
-			saved_hl = malloc(row->rsize);
-			memcpy(saved_hl, row->hl, row->rsize);
-			memset(&row->hl[match - row->render], HL_MATCH, strlen(query));
+		// long rows have no full render to mark
+		if (!row->chunks) {
+			size_t from = editorRowCxToRender(row, E->cx);
+			size_t to = editorRowCxToRender(row, E->cx + strlen(query));
+			editorInternUnshare(row);
+			f->saved_hl_line = current;
+			f->saved_hl = memAlloc(MEM_SEARCH, row->rsize);
+			memcpy(f->saved_hl, row->hl, row->rsize);
+			memset(&row->hl[from], HL_MATCH, to - from);
+		}
+		break;
+	}
+}
+
+// the rows of a replace all one thread looks at
+struct replaceChunk {
+	struct editorConfig *E;
+	const char *query, *with;
+	size_t start, end;
+	size_t *rows; // the rows it rewrote
+	size_t nrows, cap;
+	size_t count; // occurrences replaced
+};
+
+static void *editorReplaceChunk(void *arg) {
+	struct replaceChunk *c = arg;
+	size_t qlen = strlen(c->query), wlen = strlen(c->with);
+	for (size_t j = c->start; j < c->end; j++) {
+		erow *row = &c->E->row[j];
+		// cold rows with a match were thawed beforehand
+		if (row->cold) continue;
+		char *match = strstr(row->chars, c->query);
+		if (match == NULL) continue;
+
+		size_t n = 0;
+		for (char *m = match; m; m = strstr(m + qlen, c->query)) n++;
+		size_t len = row->size - n * qlen + n * wlen;
+		char *chars = memAlloc(MEM_CHARS, len + 1);
+		char *p = chars, *from = row->chars;
+		for (char *m = match; m; m = strstr(m + qlen, c->query)) {
+			memcpy(p, from, m - from);
+			p += m - from;
+			memcpy(p, c->with, wlen);
+			p += wlen;
+			from = m + qlen;
+		}
+		memcpy(p, from, row->chars + row->size - from + 1);
+		editorRowSwapChars(row, chars, len);
 
-			break;
+		if (c->nrows == c->cap) {
+			c->cap = c->cap ? c->cap * 2 : 64;
+			c->rows = realloc(c->rows, sizeof(size_t) * c->cap);
 		}
+		c->rows[c->nrows++] = j;
+		c->count += n;
 	}
+	return NULL;
 }
 
-void editorFind() {
-	int saved_cx = E.cx;
-	int saved_cy = E.cy;
-	int saved_coloff = E.coloff;
-	int saved_rowoff = E.rowoff;
+size_t editorReplaceAll(struct editorConfig *E, const char *query, const char *with) {
+	if (query[0] == '\0') return 0;
+	editorFollowWaitRows(E, SIZE_MAX);
+	// the cache of cold blocks isn't for threads, look at them here
+	for (size_t j = 0; j < E->numrows; j++) {
+		erow *row = &E->row[j];
+		if (row->cold && strstr(editorColdChars(E, row), query)) editorColdThaw(E, row);
+	}
 
-	char *query = editorPrompt("Search: %s (Use ESC/Arrows/Enter)",
-															editorFindCallback);
-	if (query) {
-		free(query);
-	} else {
-		// restore saved values
-		E.cx = saved_cx;
-		E.cy = saved_cy;
-		E.coloff = saved_coloff;
-		E.rowoff = saved_rowoff;
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nchunks = E->numrows / EDITOR_HL_CHUNK_MIN_ROWS;
+	if (ncpu > 0 && nchunks > (size_t)ncpu) nchunks = ncpu;
+	if (nchunks > EDITOR_MAX_THREADS) nchunks = EDITOR_MAX_THREADS;
+	if (nchunks == 0) nchunks = 1;
+
+	struct replaceChunk chunks[EDITOR_MAX_THREADS];
+	pthread_t threads[EDITOR_MAX_THREADS];
+	int started[EDITOR_MAX_THREADS];
+	size_t per = E->numrows / nchunks;
+	for (size_t k = 0; k < nchunks; k++) {
+		struct replaceChunk *c = &chunks[k];
+		memset(c, 0, sizeof(*c));
+		c->E = E;
+		c->query = query;
+		c->with = with;
+		c->start = k * per;
+		c->end = (k == nchunks - 1) ? E->numrows : c->start + per;
 	}
-}
\ No newline at end of file
+	for (size_t k = 1; k < nchunks; k++)
+		started[k] = pthread_create(&threads[k], NULL, editorReplaceChunk, &chunks[k]) == 0;
+	editorReplaceChunk(&chunks[0]);
+	for (size_t k = 1; k < nchunks; k++) {
+		if (started[k]) pthread_join(threads[k], NULL);
+		else editorReplaceChunk(&chunks[k]);
+	}
+
+	// the chunks' rows in order, for one pass over the offsets and highlighting
+	size_t count = 0, nrows = 0;
+	for (size_t k = 0; k < nchunks; k++) nrows += chunks[k].nrows;
+	size_t *rows = malloc(sizeof(size_t) * (nrows ? nrows : 1));
+	nrows = 0;
+	for (size_t k = 0; k < nchunks; k++) {
+		if (chunks[k].nrows) memcpy(&rows[nrows], chunks[k].rows, sizeof(size_t) * chunks[k].nrows);
+		nrows += chunks[k].nrows;
+		count += chunks[k].count;
+		free(chunks[k].rows);
+	}
+	editorRowsSwapped(E, rows, nrows);
+	free(rows);
+
+	if (E->cy < E->numrows) {
+		erow *row = &E->row[E->cy];
+		if (E->cx > row->size) E->cx = row->size;
+		E->cx = editorRowSnapCx(E, row, E->cx);
+	}
+	return count;
+}
@@ -1,11 +1,15 @@
 #ifndef __FIND_H__
 #define __FIND_H__
 
+#include "structs.h"
+
 // let user search forward and backwards through matched
-// search terms using arrow keys
-void editorFindCallback(char *query, int key);
+// search terms using arrow keys (state lives in E->find)
+void editorFindCallback(struct editorConfig *E, char *query, int key);
 
-// prompt user for search term and enter search mode
-void editorFind();
+// replace every occurrence of query with the given text, returns how
+// many there were. Each row with one is rewritten once, on worker
+// threads for large files, and highlighted once afterwards
+size_t editorReplaceAll(struct editorConfig *E, const char *query, const char *with);
 
-#endif
\ No newline at end of file
+#endif
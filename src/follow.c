@@ -0,0 +1,307 @@
+/*** feature test macros for code portability ***/
+#define _GNU_SOURCE // memrchr()
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "constants.h"
+#include "structs.h"
+#include "follow.h"
+#include "highlight.h"
+#include "row.h"
+#include "output.h"
+#include "memory.h"
+#include "fileio.h"
+
+// complete lines, each ending in '\n'
+struct followBatch {
+	char *buf;
+	size_t len;
+};
+
+struct editorFollow {
+	int fd;
+	int regular; // keep reading past the end
+	int load; // but not when loading a file, see editorFollowLoad
+	char *carry; // the reader's first buffer, starting with carry_len bytes
+	size_t carry_len;
+	int wake[2]; // the reader writes a byte when it pushes a batch
+	int stop[2]; // the main loop closes stop[1] to end the reader
+	pthread_t thread;
+
+	// the queue: ring[head .. tail) are ready. The reader only writes tail
+	// and the main loop only writes head, each publishing its side with a
+	// release store the other one reads with an acquire load
+	struct followBatch ring[EDITOR_FOLLOW_QUEUE];
+	size_t head, tail;
+	int done; // the reader is done, set after its last push
+	int error; // errno of a failed read
+	int unterminated; // the last line pushed had no '\n'
+
+	size_t lines; // appended so far
+	size_t loaded, total; // bytes, for the progress of a load
+	int exact; // see editorLoadLines
+};
+
+/*** reader thread ***/
+
+// wait up to ms (-1 for ever) for fd to be readable, just sleep if fd is
+// -1. Returns 0 once asked to stop
+static int followWait(struct editorFollow *f, int fd, int ms) {
+	struct pollfd fds[2] = {
+		{ .fd = f->stop[0], .events = POLLIN },
+		{ .fd = fd, .events = POLLIN },
+	};
+	while (poll(fds, 2, ms) == -1)
+		if (errno != EINTR) return 0;
+	return fds[0].revents == 0;
+}
+
+static void followWake(struct editorFollow *f) {
+	// if the pipe is full the main loop has yet to look anyway
+	ssize_t n = write(f->wake[1], "", 1);
+	(void)n;
+}
+
+// hand a batch to the main loop, waiting for room. Returns 0 once asked to stop
+static int followPush(struct editorFollow *f, char *buf, size_t len) {
+	size_t tail = f->tail;
+	while (tail - __atomic_load_n(&f->head, __ATOMIC_ACQUIRE) == EDITOR_FOLLOW_QUEUE) {
+		// the main loop is behind, give it time
+		if (!followWait(f, -1, 1)) return 0;
+	}
+	f->ring[tail % EDITOR_FOLLOW_QUEUE].buf = buf;
+	f->ring[tail % EDITOR_FOLLOW_QUEUE].len = len;
+	__atomic_store_n(&f->tail, tail + 1, __ATOMIC_RELEASE);
+	followWake(f);
+	return 1;
+}
+
+static void *followRead(void *arg) {
+	struct editorFollow *f = arg;
+	// carried over: a line that isn't complete yet
+	char *buf = f->carry;
+	size_t len = f->carry_len, cap = EDITOR_FOLLOW_READ + len;
+	off_t offset = 0;
+
+	for (;;) {
+		if (!f->regular && !followWait(f, f->fd, -1)) break;
+		if (cap - len < EDITOR_FOLLOW_READ / 2) {
+			cap *= 2;
+			buf = memRealloc(MEM_FILEIO, buf, cap);
+		}
+		ssize_t n = read(f->fd, buf + len, cap - len);
+		if (n == -1) {
+			if (errno == EINTR || errno == EAGAIN) continue;
+			f->error = errno;
+			break;
+		}
+		if (n == 0) {
+			if (!f->regular || f->load) break;
+			// a file cut short (log rotation) starts over, as tail does
+			struct stat st;
+			if (fstat(f->fd, &st) == 0 && st.st_size < offset)
+				offset = lseek(f->fd, 0, SEEK_SET);
+			if (!followWait(f, -1, EDITOR_FOLLOW_POLL_MS)) break;
+			continue;
+		}
+		offset += n;
+		len += n;
+
+		// pass on the complete lines, keep the rest for the next read
+		char *end = memrchr(buf, '\n', len);
+		if (end == NULL) continue;
+		size_t used = end - buf + 1;
+		char *next = memAlloc(MEM_FILEIO, cap);
+		memcpy(next, buf + used, len - used);
+		if (!followPush(f, buf, used)) {
+			memFree(next);
+			buf = NULL;
+			break;
+		}
+		buf = next;
+		len -= used;
+	}
+
+	// whatever is left of a pipe (or a loaded file) ends it, complete
+	// lines still carried over included
+	if (buf && len > 0 && (!f->regular || f->load)) {
+		if (buf[len - 1] != '\n') {
+			if (len == cap) buf = memRealloc(MEM_FILEIO, buf, cap + 1);
+			buf[len++] = '\n';
+			f->unterminated = 1;
+		}
+		if (followPush(f, buf, len)) buf = NULL;
+	}
+	memFree(buf);
+	__atomic_store_n(&f->done, 1, __ATOMIC_RELEASE);
+	followWake(f);
+	return NULL;
+}
+
+/*** main loop side ***/
+
+// start the reader on fd, which goes on from the len bytes in carry
+static int followBegin(struct editorConfig *E, int fd, int load, const char *carry,
+		size_t len, int exact) {
+	editorFollowStop(E);
+	struct stat st;
+	if (fstat(fd, &st) == -1) return -1;
+
+	struct editorFollow *f = calloc(1, sizeof(struct editorFollow));
+	if (f == NULL) return -1;
+	f->fd = fd;
+	f->regular = S_ISREG(st.st_mode);
+	f->load = load;
+	f->exact = exact;
+	if (load) {
+		off_t at = lseek(fd, 0, SEEK_CUR);
+		f->loaded = at > 0 ? at - len : 0;
+		f->total = st.st_size;
+	}
+	f->carry = memAlloc(MEM_FILEIO, EDITOR_FOLLOW_READ + len);
+	f->carry_len = len;
+	if (len) memcpy(f->carry, carry, len);
+	if (pipe(f->wake) == -1) {
+		memFree(f->carry);
+		free(f);
+		return -1;
+	}
+	if (pipe(f->stop) == -1) {
+		close(f->wake[0]);
+		close(f->wake[1]);
+		memFree(f->carry);
+		free(f);
+		return -1;
+	}
+	fcntl(f->wake[0], F_SETFL, O_NONBLOCK);
+	fcntl(f->wake[1], F_SETFL, O_NONBLOCK);
+	if (pthread_create(&f->thread, NULL, followRead, f) != 0) {
+		close(f->wake[0]);
+		close(f->wake[1]);
+		close(f->stop[0]);
+		close(f->stop[1]);
+		memFree(f->carry);
+		free(f);
+		return -1;
+	}
+	E->follow = f;
+	return 0;
+}
+
+int editorFollowStart(struct editorConfig *E, int fd) {
+	return followBegin(E, fd, 0, NULL, 0, 0);
+}
+
+int editorFollowLoad(struct editorConfig *E, int fd, const char *carry, size_t len, int exact) {
+	return followBegin(E, fd, 1, carry, len, exact);
+}
+
+void editorFollowStop(struct editorConfig *E) {
+	struct editorFollow *f = E->follow;
+	if (f == NULL) return;
+	close(f->stop[1]);
+	pthread_join(f->thread, NULL);
+	for (size_t i = f->head; i != f->tail; i++) memFree(f->ring[i % EDITOR_FOLLOW_QUEUE].buf);
+	close(f->stop[0]);
+	close(f->wake[0]);
+	close(f->wake[1]);
+	close(f->fd);
+	free(f);
+	E->follow = NULL;
+}
+
+int editorFollowFd(struct editorConfig *E) {
+	return E->follow ? E->follow->wake[0] : -1;
+}
+
+int editorFollowPending(struct editorConfig *E) {
+	struct editorFollow *f = E->follow;
+	return f && f->head != __atomic_load_n(&f->tail, __ATOMIC_ACQUIRE);
+}
+
+static long long followNow() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int editorFollowService(struct editorConfig *E) {
+	struct editorFollow *f = E->follow;
+	if (f == NULL) return 0;
+	char drain[256];
+	while (read(f->wake[0], drain, sizeof(drain)) > 0);
+
+	// read done before the queue, so the last batch isn't missed
+	int done = __atomic_load_n(&f->done, __ATOMIC_ACQUIRE);
+	size_t tail = __atomic_load_n(&f->tail, __ATOMIC_ACQUIRE);
+	size_t first = E->numrows;
+	int at_end = !f->load && E->cy + 1 >= E->numrows;
+	long long start = followNow();
+	while (f->head != tail && followNow() - start < EDITOR_FOLLOW_BUDGET_NS) {
+		struct followBatch *b = &f->ring[f->head % EDITOR_FOLLOW_QUEUE];
+		f->lines += editorLoadLines(E, b->buf, b->len, &f->exact);
+		f->loaded += b->len;
+		memFree(b->buf);
+		__atomic_store_n(&f->head, f->head + 1, __ATOMIC_RELEASE);
+	}
+	// highlight the whole lot at once
+	editorHighlightRows(E, first, E->numrows);
+	if (at_end && E->numrows > 0) {
+		E->cy = E->numrows - 1;
+		E->cx = 0;
+	}
+
+	if (done && f->head == tail) {
+		if (f->error) {
+			editorSetStatusMessage(E, "%s stopped: %s", f->load ? "Loading" : "Follow",
+				strerror(f->error));
+		} else if (f->load) {
+			editorLoadFinished(E, f->fd, f->exact && !f->unterminated);
+		} else {
+			editorSetStatusMessage(E, "End of input, %zu lines", f->lines);
+		}
+		editorFollowStop(E);
+		return 1;
+	}
+	return E->numrows != first;
+}
+
+int editorFollowProgress(struct editorConfig *E) {
+	struct editorFollow *f = E->follow;
+	if (f == NULL || !f->load) return -1;
+	if (f->loaded >= f->total) return 99;
+	return f->loaded * 100 / f->total;
+}
+
+// run the main loop's side of a load until done says so
+static void followWaitFor(struct editorConfig *E, int (*done)(struct editorConfig *, size_t),
+		size_t arg) {
+	while (E->follow && E->follow->load && !done(E, arg)) {
+		struct pollfd pfd = { .fd = E->follow->wake[0], .events = POLLIN };
+		if (!editorFollowPending(E) && poll(&pfd, 1, -1) == -1 && errno != EINTR) return;
+		editorFollowService(E);
+	}
+}
+
+static int followHasRows(struct editorConfig *E, size_t rows) {
+	return E->numrows >= rows;
+}
+
+static int followHasBytes(struct editorConfig *E, size_t bytes) {
+	return editorRowOffset(E, E->numrows) >= bytes;
+}
+
+void editorFollowWaitRows(struct editorConfig *E, size_t rows) {
+	followWaitFor(E, followHasRows, rows);
+}
+
+void editorFollowWaitBytes(struct editorConfig *E, size_t bytes) {
+	followWaitFor(E, followHasBytes, bytes);
+}
@@ -0,0 +1,45 @@
+#ifndef __FOLLOW_H__
+#define __FOLLOW_H__
+
+#include "structs.h"
+
+// follow mode: like tail -f, lines keep being appended to the rows as
+// they're written to a file, a pipe or stdin. A reader thread reads
+// complete lines in batches and hands them to the main loop through a
+// single producer single consumer queue, the main loop appends them in
+// bulk between key strokes. Appended rows don't count as changes
+
+// follow fd (taken over, closed on stop). A regular file is followed past
+// its end as it grows, a pipe until its writer closes it. Returns -1 if
+// the reader can't be started
+int editorFollowStart(struct editorConfig *E, int fd);
+
+// load the rest of a file from fd (taken over), which goes on from the len
+// bytes in carry, appending rows as they come in. Once it's all in, the
+// file counts as synced (see editorLoadFinished). Returns -1 if the
+// reader can't be started
+int editorFollowLoad(struct editorConfig *E, int fd, const char *carry, size_t len, int exact);
+
+// stop following and free the follow state
+void editorFollowStop(struct editorConfig *E);
+
+// descriptor that becomes readable when lines are waiting, -1 if not following
+int editorFollowFd(struct editorConfig *E);
+
+// whether lines are still waiting after editorFollowService ran out of time
+int editorFollowPending(struct editorConfig *E);
+
+// how much of a file is loaded (0-99%), -1 if not loading one
+int editorFollowProgress(struct editorConfig *E);
+
+// while loading a file, wait until it has at least rows rows, or bytes
+// bytes. They return right away otherwise (even when following)
+void editorFollowWaitRows(struct editorConfig *E, size_t rows);
+void editorFollowWaitBytes(struct editorConfig *E, size_t bytes);
+
+// append waiting lines for up to EDITOR_FOLLOW_BUDGET_NS, keeping the
+// cursor on the last row if it was there. Returns 1 if the screen needs a
+// repaint
+int editorFollowService(struct editorConfig *E);
+
+#endif
@@ -2,53 +2,63 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "structs.h"
 #include "constants.h"
 #include "enums.h"
 #include "filetypes.h"
+#include "highlight.h"
+#include "stats.h"
+#include "memory.h"
+#include "lexer.h"
+#include "longrow.h"
+#include "cold.h"
+#include "intern.h"
+#include "hlcache.h"
+#include "brackets.h"
 
 int is_separator(int c) {
 	return isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];", c) != NULL;
 }
 
-void editorUpdateSyntax(erow *row) {
-	row->hl = realloc(row->hl, row->rsize);
-	memset(row->hl, HL_NORMAL, row->rsize);
+int editorLexRowLegacy(struct editorSyntax *syntax, erow *row, int in_comment,
+		unsigned char *hl) {
+	memset(hl, HL_NORMAL, row->rsize);
 
-	if (E.syntax == NULL) return;
+	if (syntax == NULL) return 0;
 
-	char **keywords = E.syntax->keywords;
+	char **keywords = syntax->keywords;
 
-	char *scs = E.syntax->singleline_comment_start;
-	char *mcs = E.syntax->multiline_comment_start;
-	char *mce = E.syntax->multiline_comment_end;
+	char *scs = syntax->singleline_comment_start;
+	char *mcs = syntax->multiline_comment_start;
+	char *mce = syntax->multiline_comment_end;
 
-	int scs_len = scs ? strlen(scs) : 0;
-	int mcs_len = mcs ? strlen(mcs) : 0;
-	int mce_len = mce ? strlen(mce) : 0;
+	size_t scs_len = scs ? strlen(scs) : 0;
+	size_t mcs_len = mcs ? strlen(mcs) : 0;
+	size_t mce_len = mce ? strlen(mce) : 0;
 
 	int prev_sep = 1;
 	int in_string = 0;
-	int in_comment = (row->idx > 0 && E.row[row->idx - 1].hl_open_comment);
 
-	int i = 0;
+	size_t i = 0;
 	while (i < row->rsize) {
 		char c = row->render[i];
-		unsigned char prev_hl = (i > 0) ? row->hl[i - 1] : HL_NORMAL;
+		unsigned char prev_hl = (i > 0) ? hl[i - 1] : HL_NORMAL;
 
 		// single line comments should not be recognized in multi-line comments
 		if (scs_len && !in_string && !in_comment) {
 			if (!strncmp(&row->render[i], scs, scs_len)) {
-				memset(&row->hl[i], HL_COMMENT, row->rsize - i);
+				memset(&hl[i], HL_COMMENT, row->rsize - i);
 				break;
 			}
 		}
 
 		if (mcs_len && mce_len && !in_string) {
 			if (in_comment) {
-				row->hl[i] = HL_MLCOMMENT;
+				hl[i] = HL_MLCOMMENT;
 				if (!strncmp(&row->render[i], mce, mce_len)) {
-					memset(&row->hl[i], HL_MLCOMMENT, mce_len);
+					memset(&hl[i], HL_MLCOMMENT, mce_len);
 					i += mce_len;
 					in_comment = 0;
 					prev_sep = 1;
@@ -58,18 +68,18 @@ void editorUpdateSyntax(erow *row) {
 					continue;
 				}
 			} else if (!strncmp(&row->render[i], mcs, mcs_len)) {
-				memset(&row->hl[i], HL_MLCOMMENT, mcs_len);
+				memset(&hl[i], HL_MLCOMMENT, mcs_len);
 				i += mcs_len;
 				in_comment = 1;
 				continue;
 			}
 		}
 
-		if (E.syntax->flags & HL_HIGHLIGHT_STRINGS) {
+		if (syntax->flags & HL_HIGHLIGHT_STRINGS) {
 			if (in_string) {
-				row->hl[i] = HL_STRING;
+				hl[i] = HL_STRING;
 				if (c == '\\' && i + 1 < row->rsize) {
-					row->hl[i + 1] = HL_STRING;
+					hl[i + 1] = HL_STRING;
 					i += 2;
 					continue;
 				}
@@ -80,17 +90,17 @@ void editorUpdateSyntax(erow *row) {
 			} else {
 				if (c == '"' || c == '\'') {
 					in_string = c;
-					row->hl[i] = HL_STRING;
+					hl[i] = HL_STRING;
 					i++;
 					continue;
 				}
 			}
 		}
 
-		if (E.syntax->flags & HL_HIGHLIGHT_NUMBERS) {
+		if (syntax->flags & HL_HIGHLIGHT_NUMBERS) {
 			if ((isdigit(c) && (prev_sep || prev_hl == HL_NUMBER)) ||
 					(c == '.' && prev_hl == HL_NUMBER)) {
-				row->hl[i] = HL_NUMBER;
+				hl[i] = HL_NUMBER;
 				i++;
 				prev_sep = 0;
 				continue;
@@ -100,20 +110,20 @@ void editorUpdateSyntax(erow *row) {
 		if (prev_sep) {
 			int j;
 			for (j = 0; keywords[j]; j++) {
-				int klen = strlen(keywords[j]);
+				size_t klen = strlen(keywords[j]);
 				int kw2 = keywords[j][klen - 1] == '|';
 				if (kw2) klen--;
 
 				if (!strncmp(&row->render[i], keywords[j], klen) &&
 						is_separator(row->render[i + klen])) {
-					memset(&row->hl[i], kw2 ? HL_KEYWORD2 : HL_KEYWORD1, klen);
+					memset(&hl[i], kw2 ? HL_KEYWORD2 : HL_KEYWORD1, klen);
 					i += klen;
 					break;
 				}
-				if (keywords[j] != NULL) {
-					prev_sep = 0;
-					continue;
-				}
+			}
+			if (keywords[j] != NULL) {
+				prev_sep = 0;
+				continue;
 			}
 		}
 
@@ -121,12 +131,213 @@ void editorUpdateSyntax(erow *row) {
 		i++;
 	}
 
+	return in_comment;
+}
+
+int editorLexRow(struct editorSyntax *syntax, erow *row, int in_comment,
+		unsigned char *hl) {
+	if (syntax == NULL || syntax->lexer == NULL) {
+		memset(hl, HL_NORMAL, row->rsize);
+		return 0;
+	}
+	return lexerRun(syntax->lexer, row->render, row->rsize, in_comment, hl);
+}
+
+// a row the lexer ran on, for the highlight cache
+struct hlLexed {
+	size_t row; // SIZE_MAX if it wasn't lexed
+	uint32_t hash;
+};
+
+// highlight a row into its own hl (or chunks), returns its exit state.
+// Unless it was found in the highlight cache (or lexed already) it's
+// noted in *lexed for the caller to put it there, the workers can't
+static int editorLexRowInPlace(struct editorConfig *E, erow *row, int in_comment,
+		struct hlLexed *lexed) {
+	int state;
+	lexed->row = SIZE_MAX;
+	// a shared row lexed from the same state is lexed already
+	if (editorInternLexed(row, E->syntax, in_comment)) return row->shared->exit;
+	if (row->chunks) {
+		state = longRowHighlight(E->syntax, row, in_comment);
+	} else {
+		row->hl = memRealloc(MEM_HL, row->hl, row->rsize);
+		uint32_t hash = editorHlCacheHash(row);
+		if (!editorHlCacheGet(E, row, hash, in_comment, row->hl, &state)) {
+			state = editorLexRow(E->syntax, row, in_comment, row->hl);
+			lexed->row = row->idx;
+			lexed->hash = hash;
+		}
+	}
+	editorBracketsRow(row);
+	return state;
+}
+
+int editorHighlightRow(struct editorConfig *E, erow *row) {
+	editorColdThaw(E, row);
+	int entry = (row->idx > 0 && E->row[row->idx - 1].hl_open_comment);
+	struct hlLexed lexed;
+	int in_comment = editorLexRowInPlace(E, row, entry, &lexed);
+	if (lexed.row != SIZE_MAX) editorHlCachePut(E, row, lexed.hash, entry, in_comment);
+	editorBracketsChanged(E, row->idx);
+
 	int changed = (row->hl_open_comment != in_comment);
 	row->hl_open_comment = in_comment;
-	if (changed && row->idx + 1 < E.numrows)
-		// recursively update rows until one is unchanged for changing
-		// multi-line comments
-		editorUpdateSyntax(&E.row[row->idx + 1]);
+	return changed;
+}
+
+void editorRelexRow(struct editorConfig *E, erow *row) {
+	int in_comment = (row->idx > 0 && E->row[row->idx - 1].hl_open_comment);
+	struct hlLexed lexed;
+	int exit = editorLexRowInPlace(E, row, in_comment, &lexed);
+	if (lexed.row != SIZE_MAX) editorHlCachePut(E, row, lexed.hash, in_comment, exit);
+	editorBracketsChanged(E, row->idx);
+}
+
+void editorUpdateSyntax(struct editorConfig *E, erow *row) {
+	uint64_t start = E->stats ? statsNow() : 0;
+	// keep updating rows until one is unchanged for changing
+	// multi-line comments
+	while (editorHighlightRow(E, row) && row->idx + 1 < E->numrows)
+		row = &E->row[row->idx + 1];
+	statsPhase(E->stats, STAT_UPDATE_SYNTAX, start);
+}
+
+// a slice of rows highlighted by one thread. Unless its entry state is
+// known, a chunk is lexed as if it started outside a comment, then lexed
+// again as if it started inside one until both passes agree on a row's
+// exit state (from there on they are identical)
+struct hlChunk {
+	struct editorConfig *E;
+	size_t start, end;
+	int entry; // known entry state, -1 to speculate
+	int exit; // exit state of the chunk entered outside a comment
+	size_t nspec; // rows lexed as if entered inside a comment
+	unsigned char **spec_hl;
+	int *spec_state;
+	int converged; // the inside-comment pass caught up with the other one
+	struct hlLexed *lexed; // rows the lexer ran on
+	size_t nlexed;
+};
+
+static void *editorHighlightChunk(void *arg) {
+	struct hlChunk *c = arg;
+	struct editorConfig *E = c->E;
+
+	int state = c->entry == 1;
+	for (size_t j = c->start; j < c->end; j++) {
+		erow *row = &E->row[j];
+		state = editorLexRowInPlace(E, row, state, &c->lexed[c->nlexed]);
+		row->hl_open_comment = state;
+		if (c->lexed[c->nlexed].row != SIZE_MAX) c->nlexed++;
+	}
+	c->exit = state;
+	if (c->entry != -1) return NULL;
+
+	state = 1;
+	for (size_t j = c->start; j < c->end && !c->converged; j++) {
+		erow *row = &E->row[j];
+		// long rows keep their state in their chunks, leave them to the fixup
+		if (row->chunks) break;
+		unsigned char *hl = memAlloc(MEM_HL, row->rsize);
+		int exit;
+		if (editorHlCacheGet(E, row, editorHlCacheHash(row), state, hl, &exit)) state = exit;
+		else state = editorLexRow(E->syntax, row, state, hl);
+		c->spec_hl[c->nspec] = hl;
+		c->spec_state[c->nspec] = state;
+		c->nspec++;
+		c->converged = (state == row->hl_open_comment);
+	}
+	return NULL;
+}
+
+// stitch a speculated chunk onto its predecessor's exit state, returns
+// the chunk's real exit state
+static int editorFixupChunk(struct hlChunk *c, int entry) {
+	int exit = c->exit;
+	for (size_t k = 0; k < c->nspec; k++) {
+		if (entry) {
+			erow *row = &c->E->row[c->start + k];
+			editorInternUnshare(row);
+			memFree(row->hl);
+			row->hl = c->spec_hl[k];
+			row->hl_open_comment = c->spec_state[k];
+			editorBracketsRow(row);
+		} else {
+			memFree(c->spec_hl[k]);
+		}
+	}
+	if (entry && !c->converged && c->nspec) exit = c->spec_state[c->nspec - 1];
+	free(c->spec_hl);
+	free(c->spec_state);
+	if (entry && !c->converged && c->start + c->nspec < c->end) {
+		// speculation stopped at a long row, carry on one row at a time
+		// until the rows are back on the track of the first pass
+		size_t j;
+		for (j = c->start + c->nspec; j < c->end; j++)
+			if (!editorHighlightRow(c->E, &c->E->row[j])) break;
+		exit = c->E->row[c->end - 1].hl_open_comment;
+	}
+	return exit;
+}
+
+void editorHighlightRows(struct editorConfig *E, size_t from, size_t to) {
+	if (to > E->numrows) to = E->numrows;
+	if (from >= to) return;
+	uint64_t start = E->stats ? statsNow() : 0;
+	// the workers need text to lex
+	for (size_t j = from; j < to; j++) editorColdThaw(E, &E->row[j]);
+
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nchunks = (to - from) / EDITOR_HL_CHUNK_MIN_ROWS;
+	if (ncpu > 0 && nchunks > (size_t)ncpu) nchunks = ncpu;
+	if (nchunks > EDITOR_MAX_THREADS) nchunks = EDITOR_MAX_THREADS;
+	if (nchunks == 0) nchunks = 1;
+
+	struct hlChunk chunks[EDITOR_MAX_THREADS];
+	pthread_t threads[EDITOR_MAX_THREADS];
+	int started[EDITOR_MAX_THREADS];
+	size_t per = (to - from) / nchunks;
+	for (size_t k = 0; k < nchunks; k++) {
+		struct hlChunk *c = &chunks[k];
+		memset(c, 0, sizeof(*c));
+		c->E = E;
+		c->start = from + k * per;
+		c->end = (k == nchunks - 1) ? to : c->start + per;
+		c->entry = -1;
+		c->lexed = malloc(sizeof(struct hlLexed) * (c->end - c->start));
+		if (k == 0) c->entry = from > 0 && E->row[from - 1].hl_open_comment;
+		else {
+			c->spec_hl = malloc(sizeof(unsigned char *) * (c->end - c->start));
+			c->spec_state = malloc(sizeof(int) * (c->end - c->start));
+		}
+	}
+	// chunk 0 runs on this thread, the others get one each (or run here
+	// too if threads aren't available, e.g. a wasm build without pthreads)
+	for (size_t k = 1; k < nchunks; k++)
+		started[k] = pthread_create(&threads[k], NULL, editorHighlightChunk, &chunks[k]) == 0;
+	editorHighlightChunk(&chunks[0]);
+	for (size_t k = 1; k < nchunks; k++) {
+		if (started[k]) pthread_join(threads[k], NULL);
+		else editorHighlightChunk(&chunks[k]);
+	}
+
+	int state = chunks[0].exit;
+	for (size_t k = 1; k < nchunks; k++) state = editorFixupChunk(&chunks[k], state);
+	// the rows are all lexed from their real entry states now
+	for (size_t k = 0; k < nchunks; k++) {
+		for (size_t i = 0; i < chunks[k].nlexed; i++) {
+			erow *row = &E->row[chunks[k].lexed[i].row];
+			int entry = row->idx > 0 && E->row[row->idx - 1].hl_open_comment;
+			editorHlCachePut(E, row, chunks[k].lexed[i].hash, entry, row->hl_open_comment);
+		}
+		free(chunks[k].lexed);
+	}
+	editorBracketsRows(E, from, to);
+
+	// the row after the range may now start in a different state
+	if (to < E->numrows) editorUpdateSyntax(E, &E->row[to]);
+	statsPhase(E->stats, STAT_UPDATE_SYNTAX, start);
 }
 
 int editorSyntaxToColor(int hl) {
@@ -142,28 +353,28 @@ int editorSyntaxToColor(int hl) {
 	}
 }
 
-void editorSelectSyntaxHighlight() {
-	E.syntax = NULL;
-	if (E.filename == NULL) return;
+void editorSelectSyntax(struct editorConfig *E) {
+	E->syntax = NULL;
+	char *ext = E->filename ? strrchr(E->filename, '.') : NULL;
 
-	char *ext = strrchr(E.filename, '.');
-
-	for (unsigned int j = 0; j < HLDB_ENTRIES; j++) {
-		struct editorSyntax *s = &HLDB[j];
+	size_t count = editorSyntaxCount();
+	for (size_t j = 0; E->filename && !E->syntax && j < count; j++) {
+		struct editorSyntax *s = editorSyntaxAt(j);
 		unsigned int i = 0;
 		while (s->filematch[i]) {
 			int is_ext = (s->filematch[i][0] == '.');
 			if ((is_ext && ext && !strcmp(ext, s->filematch[i])) ||
-          (!is_ext && strstr(E.filename, s->filematch[i]))) {
-        E.syntax = s;
-
-				int filerow;
-				for (filerow = 0; filerow < E.numrows; filerow++) {
-					editorUpdateSyntax(&E.row[filerow]);
-				}
-        return;
+          (!is_ext && strstr(E->filename, s->filematch[i]))) {
+        E->syntax = s;
+        break;
       }
       i++;
 		}
 	}
-}
\ No newline at end of file
+}
+
+void editorSelectSyntaxHighlight(struct editorConfig *E) {
+	editorSelectSyntax(E);
+	// every row has to be redone for the new syntax (or lack of one)
+	editorHighlightRows(E, 0, E->numrows);
+}
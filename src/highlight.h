@@ -6,13 +6,40 @@
 // check if a character is a separator character (ie space)
 int is_separator(int c);
 
+// highlight a row into hl (row->rsize bytes) given whether the row starts
+// inside a multi-line comment, returns whether it ends inside one.
+// Uses the syntax's compiled lexer and touches nothing but hl, so rows
+// can be lexed on any thread
+int editorLexRow(struct editorSyntax *syntax, erow *row, int in_comment,
+	unsigned char *hl);
+
+// the original hand-written lexer with the same contract as editorLexRow,
+// kept as a baseline for benchmarks and cross-checks
+int editorLexRowLegacy(struct editorSyntax *syntax, erow *row, int in_comment,
+	unsigned char *hl);
+
+// highlight a single row from the state the row above leaves, returns 1
+// if its own exit state changed (the row below needs lexing then)
+int editorHighlightRow(struct editorConfig *E, erow *row);
+
 // update a row of characters with proper highlighting
-void editorUpdateSyntax(erow *row);
+void editorUpdateSyntax(struct editorConfig *E, erow *row);
+
+// lex a row again from the state the row above leaves it in, keeping
+// its exit state and the rows below as they are (its text is unchanged)
+void editorRelexRow(struct editorConfig *E, erow *row);
+
+// highlight rows [from, to) from scratch, splitting the work across
+// threads for large ranges
+void editorHighlightRows(struct editorConfig *E, size_t from, size_t to);
 
 // return appropriate highlight color
 int editorSyntaxToColor(int hl);
 
 // set syntax highlighting rules based on filetype
-void editorSelectSyntaxHighlight();
+void editorSelectSyntaxHighlight(struct editorConfig *E);
+
+// the same, leaving the rows as they are
+void editorSelectSyntax(struct editorConfig *E);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <string.h>
+#include "constants.h"
+#include "enums.h"
+#include "structs.h"
+#include "hlcache.h"
+#include "memory.h"
+
+uint32_t editorHlCacheHash(erow *row) {
+	if (row->rsize > EDITOR_HL_CACHE_MAX_LINE) return 0;
+	// a word at a time, it has to be well under what lexing costs
+	uint64_t h = 14695981039346656037ull ^ row->rsize;
+	size_t i = 0;
+	for (; i + 8 <= row->rsize; i += 8) {
+		uint64_t w;
+		memcpy(&w, &row->render[i], 8);
+		h = (h ^ w) * 1099511628211ull;
+		h ^= h >> 29;
+	}
+	for (; i < row->rsize; i++) h = (h ^ (unsigned char)row->render[i]) * 1099511628211ull;
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+// the slot a row lexed from in_comment with a syntax goes in
+static struct hlCacheSlot *hlCacheSlot(struct editorHlCache *c, uint32_t hash, int in_comment,
+		struct editorSyntax *syntax) {
+	uint32_t h = hash ^ ((uint32_t)in_comment * 0x9e3779b9u) ^ (uint32_t)((uintptr_t)syntax >> 4);
+	return &c->slots[h % EDITOR_HL_CACHE_SLOTS];
+}
+
+int editorHlCacheGet(struct editorConfig *E, erow *row, uint32_t hash, int in_comment,
+		unsigned char *hl, int *exit) {
+	struct editorHlCache *c = &E->hlcache;
+	if (row->rsize > EDITOR_HL_CACHE_MAX_LINE) return 0;
+	__atomic_add_fetch(&c->lookups, 1, __ATOMIC_RELAXED);
+	if (c->slots == NULL) return 0;
+	struct hlCacheSlot *s = hlCacheSlot(c, hash, in_comment, E->syntax);
+	if (s->data == NULL || s->hash != hash || s->len != row->rsize || s->entry != in_comment ||
+			s->syntax != E->syntax || memcmp(s->data, row->render, row->rsize) != 0)
+		return 0;
+	memcpy(hl, s->data + s->cap, row->rsize);
+	*exit = s->exit;
+	if (s->uses < EDITOR_HL_CACHE_USES) __atomic_add_fetch(&s->uses, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&c->hits, 1, __ATOMIC_RELAXED);
+	return 1;
+}
+
+void editorHlCachePut(struct editorConfig *E, erow *row, uint32_t hash, int in_comment,
+		int exit) {
+	struct editorHlCache *c = &E->hlcache;
+	if (row->chunks || row->hl == NULL || row->rsize > EDITOR_HL_CACHE_MAX_LINE) return;
+	if (c->slots == NULL) {
+		c->slots = memAlloc(MEM_HLCACHE, sizeof(struct hlCacheSlot) * EDITOR_HL_CACHE_SLOTS);
+		memset(c->slots, 0, sizeof(struct hlCacheSlot) * EDITOR_HL_CACHE_SLOTS);
+	}
+	struct hlCacheSlot *s = hlCacheSlot(c, hash, in_comment, E->syntax);
+	// the same row again (a batch of repeated lines lexed by the workers)
+	if (s->data && s->hash == hash && s->len == row->rsize && s->entry == in_comment &&
+			s->syntax == E->syntax)
+		return;
+	// a row that's been hit stays over a few rows that haven't, so the
+	// lines a file repeats aren't pushed out by the ones it doesn't
+	if (s->uses > 0) {
+		s->uses--;
+		return;
+	}
+	// a slot's buffer only grows, so a busy slot stops allocating
+	if (s->data == NULL || s->cap < row->rsize) {
+		memFree(s->data);
+		s->cap = row->rsize > 32 ? row->rsize : 32;
+		s->data = memAlloc(MEM_HLCACHE, 2 * s->cap);
+	}
+	memcpy(s->data, row->render, row->rsize);
+	memcpy(s->data + s->cap, row->hl, row->rsize);
+	s->len = row->rsize;
+	s->hash = hash;
+	s->entry = in_comment;
+	s->exit = exit;
+	s->syntax = E->syntax;
+	s->uses = 0;
+}
+
+void editorHlCacheFree(struct editorConfig *E) {
+	struct editorHlCache *c = &E->hlcache;
+	if (c->slots) {
+		for (size_t i = 0; i < EDITOR_HL_CACHE_SLOTS; i++) memFree(c->slots[i].data);
+		memFree(c->slots);
+	}
+	memset(c, 0, sizeof(*c));
+}
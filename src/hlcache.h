@@ -0,0 +1,32 @@
+#ifndef __HLCACHE_H__
+#define __HLCACHE_H__
+
+#include <stdint.h>
+#include "structs.h"
+
+// highlight cache: what the lexer made of a row's render from an entry
+// state with a syntax, so lexing the same text the same way again (the
+// rows below a comment opened and closed again, every row when the
+// syntax is picked again after a save as, repeated lines) is a copy.
+// It's direct mapped: a row going in takes the slot of whatever was in
+// it, unless that was hit since (see EDITOR_HL_CACHE_USES), and rows
+// longer than EDITOR_HL_CACHE_MAX_LINE stay out. Looking a row up is
+// safe from the highlight workers while nothing goes in
+
+// hash of a row's render, for editorHlCacheGet and editorHlCachePut (0,
+// without looking, for rows too long for the cache)
+uint32_t editorHlCacheHash(erow *row);
+
+// copy a row's highlighting from the cache into hl (rsize bytes), with
+// its exit state in *exit, returns 0 if it isn't there
+int editorHlCacheGet(struct editorConfig *E, erow *row, uint32_t hash, int in_comment,
+		unsigned char *hl, int *exit);
+
+// put a row's highlighting, lexed from in_comment to exit, in the cache
+void editorHlCachePut(struct editorConfig *E, erow *row, uint32_t hash, int in_comment,
+		int exit);
+
+// free the cache
+void editorHlCacheFree(struct editorConfig *E);
+
+#endif
@@ -1,19 +1,30 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
 #include "constants.h"
 #include "filetypes.h"
-#include "structs.h"
+#include "main.h"
 #include "fileio.h"
+#include "highlight.h"
 #include "find.h"
 #include "enums.h"
 #include "terminal.h"
 #include "editor.h"
 #include "output.h"
+#include "input.h"
+#include "stats.h"
+#include "memory.h"
+#include "follow.h"
+#include "row.h"
+#include "words.h"
+#include "brackets.h"
+#include "wrap.h"
+#include "diff.h"
 
-char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
+char *editorPrompt(char *prompt, void (*callback)(struct editorConfig *, char *, int)) {
 	size_t bufsize = 128;
 	char *buf = malloc(bufsize);
 
@@ -21,7 +32,7 @@ char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
 	buf[0] = '\0';
 
 	while(1) {
-		editorSetStatusMessage(prompt, buf);
+		editorSetStatusMessage(&E, prompt, buf);
 		editorRefreshScreen();
 
 		int c = editorReadKey();
@@ -29,14 +40,14 @@ char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
 			if (buflen != 0) buf[--buflen] = '\0';
 		} else if (c == '\x1b') {
 			// cancel saveAs with escape
-			editorSetStatusMessage("");
-			if (callback) callback(buf, c);
+			editorSetStatusMessage(&E, "");
+			if (callback) callback(&E, buf, c);
 			free(buf);
 			return NULL;
 		} else if (c == '\r') {
 			if (buflen != 0) {
-				editorSetStatusMessage("");
-				if (callback) callback(buf, c);
+				editorSetStatusMessage(&E, "");
+				if (callback) callback(&E, buf, c);
 				return buf;
 			}
 		} else if (!iscntrl(c) && c < 128) { // don't process special keys
@@ -48,16 +59,159 @@ char *editorPrompt(char *prompt, void (*callback)(char *, int)) {
 			buf[buflen] = '\0';
 		}
 
-		if (callback) callback(buf, c);
+		if (callback) callback(&E, buf, c);
 	}
 }
 
+void editorFind() {
+	// a search goes through the whole file
+	editorFollowWaitRows(&E, SIZE_MAX);
+	size_t saved_cx = E.cx;
+	size_t saved_cy = E.cy;
+	size_t saved_coloff = E.coloff;
+	size_t saved_rowoff = E.rowoff;
+
+	char *query = editorPrompt("Search: %s (Use ESC/Arrows/Enter)",
+															editorFindCallback);
+	if (query) {
+		free(query);
+	} else {
+		// restore saved values
+		E.cx = saved_cx;
+		E.cy = saved_cy;
+		E.coloff = saved_coloff;
+		E.rowoff = saved_rowoff;
+	}
+}
+
+void editorReplace() {
+	editorFollowWaitRows(&E, SIZE_MAX);
+	size_t saved_cx = E.cx;
+	size_t saved_cy = E.cy;
+	size_t saved_coloff = E.coloff;
+	size_t saved_rowoff = E.rowoff;
+
+	// pick the text as a search would, matches shown on the way
+	char *query = editorPrompt("Replace: %s (Use ESC/Arrows/Enter)", editorFindCallback);
+	E.cx = saved_cx;
+	E.cy = saved_cy;
+	E.coloff = saved_coloff;
+	E.rowoff = saved_rowoff;
+	if (query == NULL) return;
+	char *with = editorPrompt("Replace with: %s (ESC to cancel)", NULL);
+	if (with == NULL) {
+		free(query);
+		return;
+	}
+	size_t count = editorReplaceAll(&E, query, with);
+	editorSetStatusMessage(&E, "Replaced %zu occurrence%s", count, count == 1 ? "" : "s");
+	free(query);
+	free(with);
+}
+
+// what the last Ctrl-N put in, for the next one to swap
+static struct {
+	int active; // the last key was Ctrl-N
+	size_t cy, start, plen; // the row, where the word starts and its typed length
+	size_t end; // where the cursor was left
+	char *words[EDITOR_COMPLETE_MAX];
+	size_t n, at; // candidates and the one in the row (n for the word as typed)
+} complete;
+
+void editorComplete() {
+	erow *row = E.cy < E.numrows ? &E.row[E.cy] : NULL;
+	if (!complete.active || complete.n == 0 || row == NULL || E.cy != complete.cy || E.cx != complete.end) {
+		for (size_t i = 0; i < complete.n; i++) free(complete.words[i]);
+		complete.n = 0;
+		size_t start = row ? editorWordsStart(&E, row, E.cx) : E.cx;
+		if (start == E.cx) {
+			editorSetStatusMessage(&E, "Nothing to complete");
+			return;
+		}
+		// a copy, the index may look at other rows first
+		char *prefix = strndup(&row->chars[start], E.cx - start);
+		const char *words[EDITOR_COMPLETE_MAX];
+		size_t lens[EDITOR_COMPLETE_MAX];
+		complete.n = editorWordsComplete(&E, prefix, E.cx - start, words, lens, EDITOR_COMPLETE_MAX);
+		for (size_t i = 0; i < complete.n; i++) complete.words[i] = strndup(words[i], lens[i]);
+		if (complete.n == 0) editorSetStatusMessage(&E, "No completions for %.40s", prefix);
+		free(prefix);
+		if (complete.n == 0) return;
+		complete.cy = E.cy;
+		complete.start = start;
+		complete.plen = E.cx - start;
+		complete.at = complete.n;
+	}
+
+	// the next candidate in place of the last one, after the last one
+	// comes the word as typed
+	editorBeginEdit(&E);
+	while (E.cx > complete.start + complete.plen) editorDelChar(&E);
+	complete.at = (complete.at + 1) % (complete.n + 1);
+	if (complete.at < complete.n) {
+		for (const char *p = complete.words[complete.at] + complete.plen; *p; p++)
+			editorInsertChar(&E, (unsigned char)*p);
+	}
+	editorCommitEdit(&E);
+	complete.end = E.cx;
+
+	if (complete.at < complete.n) {
+		editorSetStatusMessage(&E, "Completion %zu of %zu%s", complete.at + 1, complete.n,
+			complete.n == EDITOR_COMPLETE_MAX ? " (type more for others)" : "");
+	} else {
+		editorSetStatusMessage(&E, "Back to the word as typed");
+	}
+}
+
+void editorJumpBracket() {
+	size_t bx, my, mx;
+	if (!editorBracketMatch(&E, E.cy, E.cx, &bx, &my, &mx)) {
+		editorSetStatusMessage(&E, "No matching bracket");
+		return;
+	}
+	E.cy = my;
+	E.cx = mx;
+}
+
+void editorSaveAs() {
+	if (E.filename == NULL) {
+		E.filename = editorPrompt("Save as: %s (ESC to cancel)", NULL);
+		if (E.filename == NULL) {
+			editorSetStatusMessage(&E, "Save aborted");
+			return;
+		}
+		editorSelectSyntaxHighlight(&E);
+	}
+	editorSave(&E);
+}
+
+void editorGoto(int by_offset) {
+	char *s = editorPrompt(by_offset ? "Go to byte: %s (ESC to cancel)" :
+		"Go to line: %s (ESC to cancel)", NULL);
+	if (s == NULL) return;
+
+	// offsets may be pasted from a hex dump
+	int hex = (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'));
+	char *end;
+	unsigned long long n = strtoull(hex ? s + 2 : s, &end, hex ? 16 : 10);
+	if (*end != '\0' || end == (hex ? s + 2 : s)) {
+		editorSetStatusMessage(&E, "Not a number: %s", s);
+	} else if (by_offset) {
+		editorGotoOffset(&E, n);
+	} else {
+		editorGotoLine(&E, n);
+	}
+	free(s);
+}
+
 void editorMoveCursor(int key) {
+	// moving past the rows loaded so far waits for the next one
+	if (key == ARROW_DOWN || key == ARROW_RIGHT) editorFollowWaitRows(&E, E.cy + 2);
 	erow *row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
 	switch (key) {
 		case ARROW_LEFT:
 			if (E.cx != 0) {
-				E.cx--;
+				E.cx = editorRowPrevCx(&E, row, E.cx);
 			} else if (E.cy > 0) {
 				// pressing left moves to the end of previous line
 				E.cy--;
@@ -67,19 +221,23 @@ void editorMoveCursor(int key) {
 		case ARROW_RIGHT:
 			// don't let cursor move past end of line
 			if (row && E.cx < row->size) {
-				E.cx++;
+				E.cx = editorRowNextCx(&E, row, E.cx);
 			} else if (row && E.cx == row->size) {
 				E.cy++;
 				E.cx = 0;
 			}
 			break;
 		case ARROW_UP:
-			if (E.cy != 0) {
+			if (E.wrap.on) {
+				editorWrapMoveLines(&E, -1);
+			} else if (E.cy != 0) {
 				E.cy--;
 			}
 			break;
 		case ARROW_DOWN:
-			if (E.cy < E.numrows) {
+			if (E.wrap.on) {
+				editorWrapMoveLines(&E, 1);
+			} else if (E.cy < E.numrows) {
 				E.cy++;
 			}
 			break;
@@ -87,35 +245,37 @@ void editorMoveCursor(int key) {
 
 	// make sure cursor isn't past the end of a line
 	row = (E.cy >= E.numrows) ? NULL : &E.row[E.cy];
-	int rowlen = row ? row->size : 0;
+	size_t rowlen = row ? row->size : 0;
 	if (E.cx > rowlen) {
 		E.cx = rowlen;
 	}
+	// nor in the middle of a code point
+	if (row) E.cx = editorRowSnapCx(&E, row, E.cx);
 }
 
-void editorProcessKeypress() {
+// act on a single key read by editorProcessKeypress
+static void editorHandleKey(int c) {
 	static int quit_times = EDITOR_QUIT_TIMES;
 
-	int c = editorReadKey();
-
 	switch (c) {
 		case '\r':
-			editorInsertNewline();
+			editorInsertNewline(&E);
 			break;
 		case CTRL_KEY('q'):
 			if (E.dirty && quit_times > 0) {
-				editorSetStatusMessage("WARNING! File has unsaved changes. "
+				editorSetStatusMessage(&E, "WARNING! File has unsaved changes. "
 					"Press Ctrl-Q %d more times to quit.", quit_times);
 				quit_times--;
 				return;
 			}
+			editorSessionSave(&E);
 			// clear the screen on exit
-			write(STDOUT_FILENO, "\x1b[2J", 4);
-			write(STDOUT_FILENO, "\x1b[H", 3);
+			editorWrite("\x1b[2J", 4);
+			editorWrite("\x1b[H", 3);
 			exit(0);
 			break;
 		case CTRL_KEY('s'):
-			editorSave();
+			editorSaveAs();
 			break;
 		case HOME_KEY:
 			E.cx = 0;
@@ -127,18 +287,39 @@ void editorProcessKeypress() {
 		case CTRL_KEY('f'):
 			editorFind();
 			break;
+		case CTRL_KEY('r'):
+			editorReplace();
+			break;
+		case CTRL_KEY('n'):
+			editorComplete();
+			break;
+		case CTRL_KEY('p'):
+			editorJumpBracket();
+			break;
+		case CTRL_KEY('g'):
+			editorGoto(0);
+			break;
+		case CTRL_KEY('b'):
+			editorGoto(1);
+			break;
 		case BACKSPACE:
 		case CTRL_KEY('h'):
 		case DEL_KEY:
 			if (c == DEL_KEY) editorMoveCursor(ARROW_RIGHT);
-			editorDelChar();
+			editorDelChar(&E);
 			break;
 		case PAGE_UP:
 		case PAGE_DOWN:
-			{
+			if (E.wrap.on) {
+				// to the top or bottom visual line, then a screen further
+				if (c == PAGE_DOWN) editorFollowWaitRows(&E, E.rowoff + 2 * E.screenrows);
+				editorWrapMoveLines(&E, c == PAGE_UP ? -(ssize_t)(E.wrap.y + E.screenrows) :
+					(ssize_t)(2 * E.screenrows - 1 - E.wrap.y));
+			} else {
 				if (c == PAGE_UP) {
 					E.cy = E.rowoff;
 				} else if (c == PAGE_DOWN) {
+					editorFollowWaitRows(&E, E.rowoff + 2 * E.screenrows);
 					E.cy = E.rowoff + E.screenrows - 1;
 					if (E.cy > E.numrows) E.cy = E.numrows;
 				}
@@ -153,13 +334,46 @@ void editorProcessKeypress() {
 		case ARROW_RIGHT:
 			editorMoveCursor(c);
 			break;
+		case CTRL_KEY('w'):
+			editorWrapToggle(&E);
+			editorSetStatusMessage(&E, "Soft wrap %s", E.wrap.on ? "on" : "off");
+			break;
+		case CTRL_KEY('d'):
+			editorDiffToggle(&E);
+			editorSetStatusMessage(&E, "Diff gutter %s", E.diff.on ? "on" : "off");
+			break;
+		case CTRL_KEY('t'):
+			// toggle the latency overlay in the status bar
+			if (E.stats) E.stats->overlay = !E.stats->overlay;
+			break;
+		case CTRL_KEY('u'):
+			{
+				// live memory usage per subsystem
+				char summary[sizeof(E.statusmsg)];
+				memSummary(summary, sizeof(summary));
+				editorSetStatusMessage(&E, "%s", summary);
+			}
+			break;
 		case CTRL_KEY('l'):
 		case '\x1b':
 			// don't do anything for ctrl L (refresh) and escape sequences
 			break;
 		default:
-			editorInsertChar(c);
+			editorInsertChar(&E, c);
 			break;
 	}
 	quit_times = EDITOR_QUIT_TIMES; // reset quit time counter
+	complete.active = (c == CTRL_KEY('n'));
+}
+
+void editorProcessKeypress() {
+	uint64_t start = E.stats ? statsNow() : 0;
+	int c = editorReadKey();
+	if (E.stats) {
+		// editorReadKey stamped the key's arrival
+		statsRecord(&E.stats->hist[STAT_READ_KEY], E.stats->key_time - start);
+		start = E.stats->key_time;
+	}
+	editorHandleKey(c);
+	statsPhase(E.stats, STAT_PROCESS_KEY, start);
 }
@@ -1,8 +1,31 @@
 #ifndef __INPUT_H__
 #define __INPUT_H__
 
+#include "structs.h"
+
 // prompt user in status message bar
-char *editorPrompt(char *prompt, void (*callback)(char *, int));
+char *editorPrompt(char *prompt, void (*callback)(struct editorConfig *, char *, int));
+
+// prompt user for search term and enter search mode
+void editorFind();
+
+// prompt for a search term (as editorFind) and what to replace it with,
+// then replace every occurrence
+void editorReplace();
+
+// complete the word before the cursor with a word of the buffer (see
+// words.h), again to swap in the next one
+void editorComplete();
+
+// move the cursor to the bracket matching the one under it (see
+// brackets.h)
+void editorJumpBracket();
+
+// save the file, prompting for a name if it doesn't have one yet
+void editorSaveAs();
+
+// prompt for a line number (or a byte offset) and jump there
+void editorGoto(int by_offset);
 
 // move cursor based on keypress and ensure cursor says within text
 void editorMoveCursor(int key);
@@ -10,4 +33,4 @@ void editorMoveCursor(int key);
 // process a user input keypress (raw mode)
 void editorProcessKeypress();
 
-#endif
\ No newline at end of file
+#endif
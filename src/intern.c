@@ -0,0 +1,222 @@
+#include <stdint.h>
+#include <string.h>
+#include "constants.h"
+#include "enums.h"
+#include "structs.h"
+#include "intern.h"
+#include "memory.h"
+
+// FNV-1a over a line's chars and the state it's lexed from
+static uint32_t internHash(const char *s, size_t len, int entry) {
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619u;
+	}
+	h ^= (uint32_t)entry;
+	h *= 16777619u;
+	return h;
+}
+
+// the table slot of a line like a row, or the free slot it would go in
+static size_t internFind(struct editorIntern *in, erow *row, uint32_t hash, int entry,
+		struct editorSyntax *syntax) {
+	size_t i = hash & in->mask;
+	while (in->table[i]) {
+		struct internLine *l = in->lines[in->table[i] - 1];
+		if (l->hash == hash && l->size == row->size && l->entry == entry &&
+				l->syntax == syntax && memcmp(l->chars, row->chars, row->size) == 0)
+			return i;
+		i = (i + 1) & in->mask;
+	}
+	return i;
+}
+
+// hash every line again into a table of size slots
+static void internRehash(struct editorIntern *in, size_t size) {
+	memFree(in->table);
+	in->table = memAlloc(MEM_INTERN, sizeof(uint32_t) * size);
+	memset(in->table, 0, sizeof(uint32_t) * size);
+	in->mask = size - 1;
+	for (size_t k = 0; k < in->nlines; k++) {
+		size_t i = in->lines[k]->hash & in->mask;
+		while (in->table[i]) i = (i + 1) & in->mask;
+		in->table[i] = k + 1;
+	}
+}
+
+static void internLineFree(struct internLine *l) {
+	memFree(l->chars);
+	memFree(l->render);
+	memFree(l->hl);
+	memFree(l);
+}
+
+// free the lines no row shares any more
+static void internCompact(struct editorIntern *in) {
+	size_t n = 0;
+	for (size_t k = 0; k < in->nlines; k++) {
+		struct internLine *l = in->lines[k];
+		if (__atomic_load_n(&l->refs, __ATOMIC_ACQUIRE) == 0) internLineFree(l);
+		else in->lines[n++] = l;
+	}
+	if (n == in->nlines) return;
+	in->nlines = n;
+	size_t size = 64;
+	while (size < 2 * n) size *= 2;
+	internRehash(in, size);
+}
+
+// share a row's line, handing its own copy to the table if it's the first
+static void internRow(struct editorConfig *E, erow *row) {
+	struct editorIntern *in = &E->intern;
+	int entry = row->idx > 0 && E->row[row->idx - 1].hl_open_comment;
+	uint32_t hash = internHash(row->chars, row->size, entry);
+	size_t i = internFind(in, row, hash, entry, E->syntax);
+	struct internLine *l;
+	if (in->table[i]) {
+		// a line none shares any more comes back to life here
+		l = in->lines[in->table[i] - 1];
+		__atomic_add_fetch(&l->refs, 1, __ATOMIC_ACQ_REL);
+		memFree(row->chars);
+		memFree(row->render);
+		memFree(row->hl);
+	} else {
+		if (2 * (in->nlines + 1) > in->mask + 1) {
+			internRehash(in, 2 * (in->mask + 1));
+			i = internFind(in, row, hash, entry, E->syntax);
+		}
+		if (in->nlines == in->cap) {
+			in->cap *= 2;
+			in->lines = memRealloc(MEM_INTERN, in->lines, sizeof(struct internLine *) * in->cap);
+		}
+		l = memAlloc(MEM_INTERN, sizeof(struct internLine));
+		l->chars = row->chars;
+		l->render = row->render;
+		l->hl = row->hl;
+		l->size = row->size;
+		l->rsize = row->rsize;
+		l->hash = hash;
+		l->entry = entry;
+		l->exit = row->hl_open_comment;
+		l->syntax = E->syntax;
+		l->owner = in;
+		l->refs = 1;
+		in->lines[in->nlines++] = l;
+		in->table[i] = in->nlines;
+	}
+	row->shared = l;
+	row->chars = l->chars;
+	row->render = l->render;
+	row->hl = l->hl;
+}
+
+// a row that's the only one with its line takes it back, there's
+// nothing to save by sharing it. The line is dead and no row can match
+// it until it's freed
+static void internGiveBack(erow *row) {
+	struct internLine *l = row->shared;
+	row->shared = NULL;
+	l->chars = l->render = NULL;
+	l->hl = NULL;
+	l->size = SIZE_MAX;
+	l->refs = 0;
+}
+
+void editorInternStart(struct editorConfig *E) {
+	struct editorIntern *in = &E->intern;
+	if (in->on) return;
+	in->on = 1;
+	in->cap = 64;
+	in->lines = memAlloc(MEM_INTERN, sizeof(struct internLine *) * in->cap);
+	internRehash(in, 128);
+	in->left = E->numrows;
+}
+
+int editorInternSweep(struct editorConfig *E) {
+	struct editorIntern *in = &E->intern;
+	if (!in->on) return 0;
+	// rows that stopped sharing may be worth sharing again, and their
+	// lines may be gone
+	size_t unshared = __atomic_load_n(&in->unshared, __ATOMIC_ACQUIRE);
+	if (unshared != in->seen) {
+		in->seen = unshared;
+		in->left = E->numrows;
+	}
+	if (E->numrows == 0 && (in->left > 0 || in->back > 0)) {
+		in->left = in->back = 0;
+		internCompact(in);
+	}
+
+	// a pass shares every row it can, then looks at them all again for
+	// lines only one row has
+	size_t budget = EDITOR_INTERN_SWEEP_ROWS;
+	while ((in->left > 0 || in->back > 0) && budget > 0) {
+		if (in->sweep >= E->numrows) in->sweep = 0;
+		erow *row = &E->row[in->sweep];
+		if (in->left > 0) {
+			// only short rows as they are on screen: not cold, not waiting
+			// for an edit to finish, not marked by a search
+			if (!(row->shared || row->cold || row->stale || row->chunks || row->hl == NULL ||
+					row->size >= EDITOR_LONG_ROW / 2 ||
+					(E->find.saved_hl && in->sweep == E->find.saved_hl_line)))
+				internRow(E, row);
+			if (--in->left == 0) in->back = E->numrows;
+		} else {
+			if (row->shared && __atomic_load_n(&row->shared->refs, __ATOMIC_ACQUIRE) == 1) internGiveBack(row);
+			if (--in->back == 0) internCompact(in);
+		}
+		in->sweep++;
+		budget--;
+	}
+	return in->left > 0 || in->back > 0;
+}
+
+int editorInternPending(struct editorConfig *E) {
+	struct editorIntern *in = &E->intern;
+	return in->on && (in->left > 0 || in->back > 0 || __atomic_load_n(&in->unshared, __ATOMIC_ACQUIRE) != in->seen);
+}
+
+// a row no longer shares its line
+static void internRelease(struct internLine *l) {
+	__atomic_sub_fetch(&l->refs, 1, __ATOMIC_ACQ_REL);
+	__atomic_add_fetch(&l->owner->unshared, 1, __ATOMIC_ACQ_REL);
+}
+
+void editorInternUnshare(erow *row) {
+	struct internLine *l = row->shared;
+	if (l == NULL) return;
+	row->chars = memAlloc(MEM_CHARS, l->size + 1);
+	memcpy(row->chars, l->chars, l->size + 1);
+	row->render = memAlloc(MEM_RENDER, l->rsize + 1);
+	memcpy(row->render, l->render, l->rsize + 1);
+	row->hl = memAlloc(MEM_HL, l->rsize);
+	memcpy(row->hl, l->hl, l->rsize);
+	row->shared = NULL;
+	internRelease(l);
+}
+
+void editorInternDrop(erow *row) {
+	struct internLine *l = row->shared;
+	if (l == NULL) return;
+	row->chars = row->render = NULL;
+	row->hl = NULL;
+	row->shared = NULL;
+	internRelease(l);
+}
+
+int editorInternLexed(erow *row, struct editorSyntax *syntax, int in_comment) {
+	struct internLine *l = row->shared;
+	if (l == NULL) return 0;
+	if (l->entry == in_comment && l->syntax == syntax) return 1;
+	editorInternUnshare(row);
+	return 0;
+}
+
+void editorInternFree(struct editorConfig *E) {
+	struct editorIntern *in = &E->intern;
+	for (size_t k = 0; k < in->nlines; k++) internLineFree(in->lines[k]);
+	memFree(in->lines);
+	memFree(in->table);
+	memset(in, 0, sizeof(*in));
+}
@@ -0,0 +1,43 @@
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+#include "structs.h"
+
+// line interning, for files that repeat the same lines over and over:
+// rows with the same chars, lexed from the same entry state with the same
+// syntax, share one immutable copy of chars, render and hl (struct
+// internLine), so memory goes with the unique lines. The first row with a
+// line hands its own copy over to the table. A shared row gets a copy of
+// its own again (copy on write) before anything changes it: an edit
+// through row.c, lexing it from another state, or marking its hl. Giving
+// a row its copy or dropping it touches nothing but the row and the
+// line's count, so it may happen on any thread; lines no row shares any
+// more are freed by the sweep.
+// Interning is off unless editorInternStart turns it on, the front end
+// then runs editorInternSweep while it's idle to intern rows
+
+// turn interning on
+void editorInternStart(struct editorConfig *E);
+
+// intern some more rows, returns 1 if there's more to do (the sweep
+// starts again when rows are added or given their own copy)
+int editorInternSweep(struct editorConfig *E);
+
+// the sweep has work to do
+int editorInternPending(struct editorConfig *E);
+
+// give a shared row its own chars, render and hl, nothing for other rows
+void editorInternUnshare(erow *row);
+
+// a row stops sharing its line without a copy (it's freed, or its chars
+// are replaced): chars, render and hl are left NULL
+void editorInternDrop(erow *row);
+
+// whether a row's hl is what lexing it from in_comment with syntax gives
+// (it shares a line lexed that way), else it's given its own copy to lex
+int editorInternLexed(erow *row, struct editorSyntax *syntax, int in_comment);
+
+// free the table (no row may share a line any more)
+void editorInternFree(struct editorConfig *E);
+
+#endif
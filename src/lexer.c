@@ -0,0 +1,263 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lexer.h"
+#include "constants.h"
+#include "enums.h"
+
+// byte classes
+#define LEX_SEP (1<<0) // separator (see is_separator)
+#define LEX_DIGIT (1<<1) // may start or continue a number
+#define LEX_QUOTE (1<<2) // opens a string
+#define LEX_SCS (1<<3) // first byte of the single-line comment start
+#define LEX_MCS (1<<4) // first byte of the multi-line comment start
+#define LEX_MCE (1<<5) // first byte of the multi-line comment end
+#define LEX_KW (1<<6) // first byte of some keyword
+
+struct lexerKeyword {
+	const char *s;
+	size_t len;
+	unsigned char hl;
+	size_t order; // position in the definition, earlier keywords win
+};
+
+struct editorLexer {
+	unsigned char cls[256];
+	int numbers; // HL_HIGHLIGHT_NUMBERS
+	const char *scs, *mcs, *mce;
+	size_t scs_len, mcs_len, mce_len;
+	// keywords grouped by first byte, in definition order:
+	// kw[kw_start[c] .. kw_start[c + 1])
+	struct lexerKeyword *kw;
+	size_t kw_start[257];
+};
+
+static int lexerCompareFirst(const void *a, const void *b) {
+	const struct lexerKeyword *x = a, *y = b;
+	int d = (unsigned char)x->s[0] - (unsigned char)y->s[0];
+	if (d) return d;
+	// keep definition order within a bucket
+	return x->order < y->order ? -1 : x->order > y->order;
+}
+
+struct editorLexer *lexerCompile(struct editorSyntax *syntax) {
+	struct editorLexer *L = calloc(1, sizeof(struct editorLexer));
+	if (L == NULL) return NULL;
+
+	for (int c = 0; c < 256; c++) {
+		if (isspace(c) || c == '\0' || strchr(",.()+-/*=~%<>[];", c)) L->cls[c] |= LEX_SEP;
+	}
+	L->numbers = (syntax->flags & HL_HIGHLIGHT_NUMBERS) != 0;
+	if (L->numbers) {
+		for (int c = '0'; c <= '9'; c++) L->cls[c] |= LEX_DIGIT;
+	}
+	if (syntax->flags & HL_HIGHLIGHT_STRINGS) {
+		L->cls['"'] |= LEX_QUOTE;
+		L->cls['\''] |= LEX_QUOTE;
+	}
+
+	L->scs = syntax->singleline_comment_start;
+	L->scs_len = L->scs ? strlen(L->scs) : 0;
+	if (L->scs_len) L->cls[(unsigned char)L->scs[0]] |= LEX_SCS;
+	L->mcs = syntax->multiline_comment_start;
+	L->mce = syntax->multiline_comment_end;
+	L->mcs_len = L->mcs ? strlen(L->mcs) : 0;
+	L->mce_len = L->mce ? strlen(L->mce) : 0;
+	// multi-line comments need both delimiters
+	if (L->mcs_len && L->mce_len) {
+		L->cls[(unsigned char)L->mcs[0]] |= LEX_MCS;
+		L->cls[(unsigned char)L->mce[0]] |= LEX_MCE;
+	} else {
+		L->mcs_len = L->mce_len = 0;
+	}
+
+	size_t nkw = 0;
+	while (syntax->keywords && syntax->keywords[nkw]) nkw++;
+	L->kw = malloc(sizeof(struct lexerKeyword) * (nkw ? nkw : 1));
+	if (L->kw == NULL) {
+		free(L);
+		return NULL;
+	}
+	size_t n = 0;
+	for (size_t j = 0; j < nkw; j++) {
+		const char *k = syntax->keywords[j];
+		size_t klen = strlen(k);
+		int kw2 = klen && k[klen - 1] == '|';
+		if (kw2) klen--;
+		if (klen == 0) continue;
+		L->kw[n].s = k;
+		L->kw[n].len = klen;
+		L->kw[n].hl = kw2 ? HL_KEYWORD2 : HL_KEYWORD1;
+		L->kw[n].order = j;
+		L->cls[(unsigned char)k[0]] |= LEX_KW;
+		n++;
+	}
+	qsort(L->kw, n, sizeof(struct lexerKeyword), lexerCompareFirst);
+	size_t j = 0;
+	for (int c = 0; c <= 256; c++) {
+		while (c < 256 && j < n && (unsigned char)L->kw[j].s[0] < c) j++;
+		L->kw_start[c] = (c == 256) ? n : j;
+	}
+	return L;
+}
+
+void lexerFree(struct editorLexer *lexer) {
+	if (lexer == NULL) return;
+	free(lexer->kw);
+	free(lexer);
+}
+
+// does the delimiter d (len bytes) start at s[i]
+static inline int lexerAt(const char *s, size_t n, size_t i, const char *d, size_t len) {
+	return n - i >= len && !memcmp(&s[i], d, len);
+}
+
+// set hl for bytes [i, i + len) that fall inside [from, to)
+static inline void lexerFill(unsigned char *hl, size_t from, size_t to,
+		size_t i, size_t len, unsigned char v) {
+	size_t end = i + len < to ? i + len : to;
+	if (end > i) memset(&hl[i - from], v, end - i);
+}
+
+void lexerStateInit(struct lexerState *st, int in_comment) {
+	memset(st, 0, sizeof(*st));
+	st->in_comment = in_comment;
+	st->prev_sep = 1;
+}
+
+int lexerStateEqual(const struct lexerState *a, const struct lexerState *b) {
+	return a->in_comment == b->in_comment && a->in_string == b->in_string &&
+		a->line_comment == b->line_comment && a->prev_sep == b->prev_sep &&
+		a->prev_number == b->prev_number && a->skip == b->skip &&
+		(a->skip == 0 || a->skip_hl == b->skip_hl);
+}
+
+void lexerResume(const struct editorLexer *L, const char *s, size_t n,
+		size_t from, size_t to, struct lexerState *st, unsigned char *hl) {
+	memset(hl, HL_NORMAL, to - from);
+	if (st->line_comment) {
+		memset(hl, HL_COMMENT, to - from);
+		return;
+	}
+	// without multi-line comments there is no state to carry between rows
+	int in_comment = L->mce_len ? st->in_comment : 0;
+	int in_string = st->in_string;
+	int prev_sep = st->prev_sep;
+	int prev_number = st->prev_number;
+	unsigned char last = st->skip_hl; // highlight of the last multi-byte match
+
+	size_t i = from;
+	if (st->skip) {
+		lexerFill(hl, from, to, i, st->skip, last);
+		i += st->skip;
+	}
+	while (i < to) {
+		if (in_comment) {
+			// skip ahead to the next byte that could end the comment
+			size_t j = i;
+			while (j < to && !((L->cls[(unsigned char)s[j]] & LEX_MCE) &&
+					lexerAt(s, n, j, L->mce, L->mce_len)))
+				j++;
+			lexerFill(hl, from, to, i, j - i, HL_MLCOMMENT);
+			if (j == to) {
+				i = to;
+				break;
+			}
+			last = HL_MLCOMMENT;
+			lexerFill(hl, from, to, j, L->mce_len, last);
+			i = j + L->mce_len;
+			in_comment = 0;
+			prev_sep = 1;
+			prev_number = 0;
+			continue;
+		}
+
+		unsigned char c = s[i];
+		if (in_string) {
+			hl[i - from] = HL_STRING;
+			prev_number = 0;
+			if (c == '\\' && i + 1 < n) {
+				last = HL_STRING;
+				lexerFill(hl, from, to, i, 2, last);
+				i += 2;
+				continue;
+			}
+			if (c == in_string) in_string = 0;
+			i++;
+			prev_sep = 1;
+			continue;
+		}
+
+		unsigned char cls = L->cls[c];
+		if (cls & ~(LEX_SEP | LEX_DIGIT)) {
+			if ((cls & LEX_SCS) && lexerAt(s, n, i, L->scs, L->scs_len)) {
+				lexerFill(hl, from, to, i, to - i, HL_COMMENT);
+				st->line_comment = 1;
+				i = to;
+				break;
+			}
+			if ((cls & LEX_MCS) && lexerAt(s, n, i, L->mcs, L->mcs_len)) {
+				last = HL_MLCOMMENT;
+				lexerFill(hl, from, to, i, L->mcs_len, last);
+				i += L->mcs_len;
+				in_comment = 1;
+				prev_number = 0;
+				continue;
+			}
+			if (cls & LEX_QUOTE) {
+				in_string = c;
+				hl[i - from] = HL_STRING;
+				i++;
+				prev_number = 0;
+				continue;
+			}
+		}
+
+		if (L->numbers) {
+			if (((cls & LEX_DIGIT) && (prev_sep || prev_number)) ||
+					(c == '.' && prev_number)) {
+				hl[i - from] = HL_NUMBER;
+				i++;
+				prev_sep = 0;
+				prev_number = 1;
+				continue;
+			}
+		}
+		prev_number = 0;
+
+		if (prev_sep && (cls & LEX_KW)) {
+			const struct lexerKeyword *k = &L->kw[L->kw_start[c]];
+			const struct lexerKeyword *end = &L->kw[L->kw_start[c + 1]];
+			for (; k < end; k++) {
+				if (lexerAt(s, n, i, k->s, k->len) &&
+						(i + k->len == n || (L->cls[(unsigned char)s[i + k->len]] & LEX_SEP)))
+					break;
+			}
+			if (k < end) {
+				last = k->hl;
+				lexerFill(hl, from, to, i, k->len, last);
+				i += k->len;
+				prev_sep = 0;
+				continue;
+			}
+		}
+
+		prev_sep = (cls & LEX_SEP) != 0;
+		i++;
+	}
+
+	st->in_comment = in_comment;
+	st->in_string = in_string;
+	st->prev_sep = prev_sep;
+	st->prev_number = prev_number;
+	st->skip = i - to;
+	st->skip_hl = last;
+}
+
+int lexerRun(const struct editorLexer *L, const char *s, size_t n,
+		int in_comment, unsigned char *hl) {
+	struct lexerState st;
+	lexerStateInit(&st, in_comment);
+	lexerResume(L, s, n, 0, n, &st, hl);
+	return st.in_comment;
+}
@@ -0,0 +1,35 @@
+#ifndef __LEXER_H__
+#define __LEXER_H__
+
+#include <stddef.h>
+#include "structs.h"
+
+// a syntax definition compiled into lookup tables: every byte maps to a
+// class telling the lexer what it could start (separator, digit, quote,
+// comment delimiter, keyword), so the hot loop is one table lookup per
+// byte instead of strncmp/strchr calls
+
+// compile a syntax definition, returns NULL if out of memory
+struct editorLexer *lexerCompile(struct editorSyntax *syntax);
+
+// free a compiled lexer
+void lexerFree(struct editorLexer *lexer);
+
+// highlight n bytes of s into hl given whether they start inside a
+// multi-line comment, returns whether they end inside one
+int lexerRun(const struct editorLexer *lexer, const char *s, size_t n,
+	int in_comment, unsigned char *hl);
+
+// the state at the start of a row, inside a multi-line comment or not
+void lexerStateInit(struct lexerState *st, int in_comment);
+
+// whether lexing would carry on the same way from a and b
+int lexerStateEqual(const struct lexerState *a, const struct lexerState *b);
+
+// highlight bytes [from, to) of the n bytes of s into hl (to - from bytes)
+// starting from state st, which is updated to the state at to. Matches
+// may look at bytes past to, so a row can be lexed piecewise
+void lexerResume(const struct editorLexer *lexer, const char *s, size_t n,
+	size_t from, size_t to, struct lexerState *st, unsigned char *hl);
+
+#endif
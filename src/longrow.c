@@ -0,0 +1,286 @@
+#include <string.h>
+#include "constants.h"
+#include "enums.h"
+#include "structs.h"
+#include "lexer.h"
+#include "longrow.h"
+#include "memory.h"
+
+// measure the tab layout of a chunk, see struct erowChunk
+static void longRowMeasure(erow *row, struct erowChunk *c) {
+	const char *s = &row->chars[c->start];
+	size_t j = 0;
+	while (j < c->len && s[j] != '\t') j++;
+	c->lead = j;
+	size_t col = 0;
+	for (j++; j < c->len; j++) {
+		if (s[j] == '\t') col += EDITOR_TAB_STOP - col % EDITOR_TAB_STOP;
+		else col++;
+	}
+	c->tail = col;
+}
+
+// render column right after a chunk
+static size_t longRowColumnAfter(const struct erowChunk *c) {
+	if (c->lead == c->len) return c->rx + c->len;
+	size_t col = c->rx + c->lead;
+	col += EDITOR_TAB_STOP - col % EDITOR_TAB_STOP;
+	return col + c->tail;
+}
+
+// recompute start and rx of the chunks after chunk k, and the row's rsize
+static void longRowPrefix(erow *row, size_t k) {
+	struct erowChunks *rc = row->chunks;
+	for (; k + 1 < rc->n; k++) {
+		rc->c[k + 1].start = rc->c[k].start + rc->c[k].len;
+		rc->c[k + 1].rx = longRowColumnAfter(&rc->c[k]);
+	}
+	row->rsize = longRowColumnAfter(&rc->c[rc->n - 1]);
+}
+
+// index of the chunk holding chars[cx] (the last one for cx == size)
+static size_t longRowFindCx(struct erowChunks *rc, size_t cx) {
+	size_t lo = 0, hi = rc->n - 1;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo + 1) / 2;
+		if (rc->c[mid].start <= cx) lo = mid;
+		else hi = mid - 1;
+	}
+	return lo;
+}
+
+// index of the chunk holding render column rx
+static size_t longRowFindRx(struct erowChunks *rc, size_t rx) {
+	size_t lo = 0, hi = rc->n - 1;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo + 1) / 2;
+		if (rc->c[mid].rx <= rx) lo = mid;
+		else hi = mid - 1;
+	}
+	return lo;
+}
+
+static void longRowMarkDirty(struct erowChunks *rc, size_t from, size_t to) {
+	if (rc->dirty_from > rc->dirty_to) {
+		rc->dirty_from = from;
+		rc->dirty_to = to;
+	} else {
+		if (from < rc->dirty_from) rc->dirty_from = from;
+		if (to > rc->dirty_to) rc->dirty_to = to;
+	}
+	rc->wvalid = 0;
+}
+
+void longRowBuild(erow *row) {
+	memFree(row->render);
+	memFree(row->hl);
+	row->render = NULL;
+	row->hl = NULL;
+	longRowFree(row);
+
+	// every chunk but the last is EDITOR_ROW_CHUNK bytes, the last one
+	// takes the remainder so it's never shorter than that
+	size_t n = row->size / EDITOR_ROW_CHUNK;
+	if (n == 0) n = 1;
+	struct erowChunks *rc = memAlloc(MEM_ROWS, sizeof(struct erowChunks));
+	rc->c = memAlloc(MEM_ROWS, sizeof(struct erowChunk) * n);
+	rc->n = n;
+	for (size_t k = 0; k < n; k++) {
+		struct erowChunk *c = &rc->c[k];
+		c->start = k * EDITOR_ROW_CHUNK;
+		c->len = (k == n - 1) ? row->size - c->start : EDITOR_ROW_CHUNK;
+		c->rx = 0;
+		longRowMeasure(row, c);
+		lexerStateInit(&c->entry, 0);
+	}
+	lexerStateInit(&rc->exit, 0);
+	rc->syntax = NULL;
+	rc->dirty_from = 1;
+	rc->dirty_to = 0;
+	longRowMarkDirty(rc, 0, n - 1);
+	row->chunks = rc;
+	longRowPrefix(row, 0);
+}
+
+void longRowFree(erow *row) {
+	if (row->chunks == NULL) return;
+	memFree(row->chunks->c);
+	memFree(row->chunks);
+	row->chunks = NULL;
+}
+
+// split chunk k in two halves
+static void longRowSplit(struct erowChunks *rc, size_t k) {
+	rc->c = memRealloc(MEM_ROWS, rc->c, sizeof(struct erowChunk) * (rc->n + 1));
+	memmove(&rc->c[k + 1], &rc->c[k], sizeof(struct erowChunk) * (rc->n - k));
+	rc->n++;
+	size_t half = rc->c[k].len / 2;
+	rc->c[k + 1].len = rc->c[k].len - half;
+	rc->c[k].len = half;
+}
+
+// merge chunk k + 1 into chunk k
+static void longRowMerge(struct erowChunks *rc, size_t k) {
+	rc->c[k].len += rc->c[k + 1].len;
+	memmove(&rc->c[k + 1], &rc->c[k + 2], sizeof(struct erowChunk) * (rc->n - k - 2));
+	rc->n--;
+}
+
+void longRowEdit(erow *row, size_t at, int delta) {
+	struct erowChunks *rc = row->chunks;
+	size_t k = longRowFindCx(rc, at);
+	if (delta > 0) rc->c[k].len++;
+	else rc->c[k].len--;
+
+	size_t n = rc->n;
+	size_t first = k, last = k;
+	if (rc->c[k].len > 2 * EDITOR_ROW_CHUNK) {
+		longRowSplit(rc, k);
+		last = k + 1;
+	} else if (rc->c[k].len < EDITOR_ROW_CHUNK / 4 && rc->n > 1) {
+		first = last = (k + 1 < rc->n) ? k : k - 1;
+		longRowMerge(rc, first);
+		if (rc->c[first].len > 2 * EDITOR_ROW_CHUNK) {
+			longRowSplit(rc, first);
+			last = first + 1;
+		}
+	}
+	for (size_t j = first; j <= last; j++) {
+		if (j > first) rc->c[j].start = rc->c[j - 1].start + rc->c[j - 1].len;
+		longRowMeasure(row, &rc->c[j]);
+	}
+	longRowPrefix(row, first);
+
+	// chunk indexes moved under a pending re-lex, redo the rest of the row
+	if (rc->n != n && rc->dirty_from <= rc->dirty_to) rc->dirty_to = rc->n - 1;
+	// the lexer looks past the end of a chunk, so the one before the edit
+	// may end in a different state too
+	longRowMarkDirty(rc, first ? first - 1 : 0, last);
+}
+
+int longRowHighlight(struct editorSyntax *syntax, erow *row, int in_comment) {
+	struct erowChunks *rc = row->chunks;
+	if (syntax == NULL || syntax->lexer == NULL) {
+		for (size_t k = 0; k < rc->n; k++) lexerStateInit(&rc->c[k].entry, 0);
+		lexerStateInit(&rc->exit, 0);
+		rc->syntax = syntax;
+		rc->dirty_from = 1;
+		rc->dirty_to = 0;
+		rc->wvalid = 0;
+		return 0;
+	}
+
+	struct lexerState st;
+	lexerStateInit(&st, in_comment);
+	if (rc->syntax != syntax || !lexerStateEqual(&st, &rc->c[0].entry)) {
+		rc->syntax = syntax;
+		rc->c[0].entry = st;
+		longRowMarkDirty(rc, 0, 0);
+	}
+	if (rc->dirty_from > rc->dirty_to) return rc->exit.in_comment;
+
+	// chunks are at most 2 * EDITOR_ROW_CHUNK bytes
+	unsigned char scratch[2 * EDITOR_ROW_CHUNK];
+	size_t k = rc->dirty_from;
+	st = rc->c[k].entry;
+	for (;; k++) {
+		struct erowChunk *c = &rc->c[k];
+		lexerResume(syntax->lexer, row->chars, row->size, c->start, c->start + c->len,
+			&st, scratch);
+		if (k + 1 == rc->n) {
+			rc->exit = st;
+			break;
+		}
+		// past the edited chunks, stop once the lexer is back on its old track
+		if (k >= rc->dirty_to && lexerStateEqual(&st, &c[1].entry)) break;
+		c[1].entry = st;
+	}
+	rc->dirty_from = 1;
+	rc->dirty_to = 0;
+	rc->wvalid = 0;
+	return rc->exit.in_comment;
+}
+
+size_t longRowCxToRx(erow *row, size_t cx) {
+	if (cx >= row->size) return row->rsize;
+	struct erowChunk *c = &row->chunks->c[longRowFindCx(row->chunks, cx)];
+	size_t rx = c->rx;
+	for (size_t j = c->start; j < cx; j++) {
+		if (row->chars[j] == '\t')
+			rx += (EDITOR_TAB_STOP - 1) - (rx % EDITOR_TAB_STOP);
+		rx++;
+	}
+	return rx;
+}
+
+size_t longRowRxToCx(erow *row, size_t rx) {
+	if (rx >= row->rsize) return row->size;
+	struct erowChunk *c = &row->chunks->c[longRowFindRx(row->chunks, rx)];
+	size_t cur_rx = c->rx;
+	size_t cx;
+	for (cx = c->start; cx < row->size; cx++) {
+		if (row->chars[cx] == '\t')
+			cur_rx += (EDITOR_TAB_STOP - 1) - (cur_rx % EDITOR_TAB_STOP);
+		cur_rx++;
+
+		if (cur_rx > rx) return cx;
+	}
+	return cx;
+}
+
+// render and highlight chunks [a, b] into the row's window. The lexer
+// works on chars, a tab gets the highlight of its byte on every column
+static void longRowExpand(struct editorSyntax *syntax, erow *row, size_t a, size_t b) {
+	struct erowChunks *rc = row->chunks;
+	size_t end = (b + 1 < rc->n) ? rc->c[b + 1].rx : row->rsize;
+	size_t width = end - rc->c[a].rx;
+	row->render = memRealloc(MEM_RENDER, row->render, width + 1);
+	row->hl = memRealloc(MEM_HL, row->hl, width);
+
+	unsigned char scratch[2 * EDITOR_ROW_CHUNK];
+	size_t idx = 0;
+	size_t col = rc->c[a].rx;
+	for (size_t k = a; k <= b; k++) {
+		struct erowChunk *c = &rc->c[k];
+		if (syntax && syntax->lexer) {
+			struct lexerState st = c->entry;
+			lexerResume(syntax->lexer, row->chars, row->size, c->start, c->start + c->len,
+				&st, scratch);
+		} else {
+			memset(scratch, HL_NORMAL, c->len);
+		}
+		for (size_t j = 0; j < c->len; j++) {
+			char ch = row->chars[c->start + j];
+			if (ch == '\t') {
+				do {
+					row->render[idx] = ' ';
+					row->hl[idx++] = scratch[j];
+				} while (++col % EDITOR_TAB_STOP != 0);
+			} else {
+				row->render[idx] = ch;
+				row->hl[idx++] = scratch[j];
+				col++;
+			}
+		}
+	}
+	row->render[idx] = '\0';
+	rc->wvalid = 1;
+	rc->wfirst = a;
+	rc->wlast = b;
+}
+
+char *longRowView(struct editorSyntax *syntax, erow *row, size_t rx, size_t len,
+		unsigned char **hl) {
+	struct erowChunks *rc = row->chunks;
+	if (len == 0 || rx >= row->rsize) {
+		*hl = row->hl;
+		return row->render;
+	}
+	size_t a = longRowFindRx(rc, rx);
+	size_t b = longRowFindRx(rc, rx + len - 1);
+	if (!rc->wvalid || a < rc->wfirst || b > rc->wlast) longRowExpand(syntax, row, a, b);
+
+	size_t off = rx - rc->c[rc->wfirst].rx;
+	*hl = &row->hl[off];
+	return &row->render[off];
+}
@@ -0,0 +1,35 @@
+#ifndef __LONGROW_H__
+#define __LONGROW_H__
+
+#include "structs.h"
+
+// rows longer than EDITOR_LONG_ROW (minified JSON, logs with blobs) are
+// split into chunks that remember their render column and the lexer state
+// they start in. Edits re-measure and re-lex the chunk they touch (plus
+// whatever a changed lexer state cascades into), and drawing only renders
+// and highlights the chunks on screen. row->rsize still is the width of
+// the whole row
+
+// split a row into chunks, dropping its flat render and highlight
+void longRowBuild(erow *row);
+
+// free the chunks of a row (not its render window)
+void longRowFree(erow *row);
+
+// update the chunks after chars[at] was inserted (delta 1) or removed (-1)
+void longRowEdit(erow *row, size_t at, int delta);
+
+// re-lex the chunks that changed given the row's entry state, returns
+// whether the row ends inside a multi-line comment
+int longRowHighlight(struct editorSyntax *syntax, erow *row, int in_comment);
+
+// editorRowCxToRx/editorRowRxToCx for chunked rows
+size_t longRowCxToRx(erow *row, size_t cx);
+size_t longRowRxToCx(erow *row, size_t rx);
+
+// render and highlight the chunks covering columns [rx, rx + len) into the
+// row's window, returns the render text at rx and its highlight in *hl
+char *longRowView(struct editorSyntax *syntax, erow *row, size_t rx, size_t len,
+	unsigned char **hl);
+
+#endif
@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include <string.h>
+#include "lz.h"
+
+// A sequence is a token byte, literals and a match:
+//   token: literal count in the high nibble, match length - LZ_MIN_MATCH
+//          in the low one, 15 meaning more follows in bytes of 255 and
+//          a last one below that
+//   the literal count's extra bytes, then the literals
+//   match offset (2 bytes, little endian), the match length's extra bytes
+// The last sequence has no match, its literals end the input
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+
+size_t lzBound(size_t n) {
+	return n + n / 255 + 16;
+}
+
+static uint32_t lzRead32(const unsigned char *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static size_t lzHash(uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static unsigned char *lzPutLength(unsigned char *op, size_t len) {
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = len;
+	return op;
+}
+
+static unsigned char *lzPutSequence(unsigned char *op, const unsigned char *lit, size_t nlit,
+		size_t offset, size_t mlen) {
+	size_t m = mlen ? mlen - LZ_MIN_MATCH : 0;
+	*op++ = (nlit < 15 ? nlit : 15) << 4 | (m < 15 ? m : 15);
+	if (nlit >= 15) op = lzPutLength(op, nlit - 15);
+	memcpy(op, lit, nlit);
+	op += nlit;
+	if (mlen) {
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		if (m >= 15) op = lzPutLength(op, m - 15);
+	}
+	return op;
+}
+
+size_t lzCompress(const unsigned char *src, size_t n, unsigned char *dst) {
+	// 1 + where the last sequence with each hash started, 0 if none did
+	uint32_t table[1 << LZ_HASH_BITS];
+	memset(table, 0, sizeof(table));
+
+	const unsigned char *ip = src, *anchor = src, *end = src + n;
+	const unsigned char *limit = n >= LZ_MIN_MATCH ? end - LZ_MIN_MATCH + 1 : src;
+	unsigned char *op = dst;
+	while (ip < limit) {
+		uint32_t seq = lzRead32(ip);
+		size_t h = lzHash(seq);
+		const unsigned char *ref = table[h] ? src + table[h] - 1 : NULL;
+		table[h] = ip - src + 1;
+		if (ref == NULL || ip - ref > LZ_MAX_OFFSET || lzRead32(ref) != seq) {
+			ip++;
+			continue;
+		}
+		size_t mlen = LZ_MIN_MATCH;
+		while (ip + mlen < end && ip[mlen] == ref[mlen]) mlen++;
+		op = lzPutSequence(op, anchor, ip - anchor, ip - ref, mlen);
+		ip += mlen;
+		anchor = ip;
+	}
+	op = lzPutSequence(op, anchor, end - anchor, 0, 0);
+	return op - dst;
+}
+
+static int lzGetLength(const unsigned char **ip, const unsigned char *end, size_t *len) {
+	unsigned char b;
+	do {
+		if (*ip == end) return -1;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return 0;
+}
+
+int lzDecompress(const unsigned char *src, size_t len, unsigned char *dst, size_t n) {
+	const unsigned char *ip = src, *iend = src + len;
+	unsigned char *op = dst, *oend = dst + n;
+	while (ip < iend) {
+		unsigned token = *ip++;
+		size_t nlit = token >> 4;
+		if (nlit == 15 && lzGetLength(&ip, iend, &nlit) == -1) return -1;
+		if ((size_t)(iend - ip) < nlit || (size_t)(oend - op) < nlit) return -1;
+		memcpy(op, ip, nlit);
+		op += nlit;
+		ip += nlit;
+		if (ip == iend) break;
+
+		if (iend - ip < 2) return -1;
+		size_t offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		size_t mlen = token & 15;
+		if (mlen == 15 && lzGetLength(&ip, iend, &mlen) == -1) return -1;
+		mlen += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(oend - op) < mlen) return -1;
+		// a match can overlap what it copies (a run), go a byte at a time then
+		const unsigned char *ref = op - offset;
+		if (offset >= mlen) {
+			memcpy(op, ref, mlen);
+		} else {
+			for (size_t i = 0; i < mlen; i++) op[i] = ref[i];
+		}
+		op += mlen;
+	}
+	return op == oend ? 0 : -1;
+}
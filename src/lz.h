@@ -0,0 +1,21 @@
+#ifndef __LZ_H__
+#define __LZ_H__
+
+#include <stddef.h>
+
+// a small LZ77 codec in the style of LZ4: a hash table of the last place
+// each 4-byte sequence was seen finds matches up to 64K back, and the
+// output is a run of (literals, match) sequences. Fast both ways and
+// good enough on text, which repeats itself a lot (logs, source)
+
+// room compressing n bytes can take at most
+size_t lzBound(size_t n);
+
+// compress n bytes of src into dst (lzBound(n) bytes), returns the length
+size_t lzCompress(const unsigned char *src, size_t n, unsigned char *dst);
+
+// decompress len bytes of src into the n bytes of dst, returns 0 if it
+// fills them exactly, -1 if src is corrupt
+int lzDecompress(const unsigned char *src, size_t len, unsigned char *dst, size_t n);
+
+#endif
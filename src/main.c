@@ -3,43 +3,151 @@
 #define _BSD_SOURCE // gettimeofday() for linux
 #define _GNU_SOURCE // modern glibc will complain about the above without this
 
-#include "structs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "main.h"
+#include "editor.h"
 #include "terminal.h"
 #include "fileio.h"
 #include "input.h"
 #include "output.h"
+#include "stats.h"
+#include "memory.h"
+#include "record.h"
+#include "vterm.h"
+#include "follow.h"
+#include "intern.h"
+#include "hlcache.h"
 
 struct editorConfig E;
 
+// main loop timings (toggle the overlay with Ctrl-T)
+static struct editorStats stats;
+
 /*** Init ***/
 
+// dump the timing histograms and the highlight cache's hit rate to the
+// file named by WASM_EDITOR_STATS ("-" for stderr) on exit
+void editorDumpStats() {
+	char *path = getenv("WASM_EDITOR_STATS");
+	if (path == NULL || path[0] == '\0') return;
+	FILE *fp = strcmp(path, "-") ? fopen(path, "w") : stderr;
+	if (fp == NULL) return;
+	statsDump(&stats, fp);
+	fprintf(fp, "hl_cache: lookups=%zu hits=%zu\n", E.hlcache.lookups, E.hlcache.hits);
+	if (fp != stderr) fclose(fp);
+}
+
+// dump per-subsystem memory usage to the file named by
+// WASM_EDITOR_MEMSTATS ("-" for stderr) on exit
+void editorDumpMemory() {
+	char *path = getenv("WASM_EDITOR_MEMSTATS");
+	if (path == NULL || path[0] == '\0') return;
+	FILE *fp = strcmp(path, "-") ? fopen(path, "w") : stderr;
+	if (fp == NULL) return;
+	memDump(fp);
+	if (fp != stderr) fclose(fp);
+}
+
 void initEditor() {
-	E.cx = 0;
-	E.cy = 0;
-	E.rx = 0;
-	E.rowoff = 0;
-	E.coloff = 0;
-	E.numrows = 0;
-	E.row = NULL;
-	E.dirty = 0;
-	E.filename = NULL;
-	E.statusmsg[0] = '\0';
-	E.statusmsg_time = 0;
-	E.syntax = NULL;
-
-	if (getWindowSize(&E.screenrows, &E.screencols) == -1) die("getWindowSize");
-	E.screenrows -= 2;
+	int rows, cols;
+	if (getWindowSize(&rows, &cols) == -1) die("getWindowSize");
+	editorInit(&E, rows - 2, cols);
+	E.stats = &stats;
+	atexit(editorDumpStats);
+	atexit(editorDumpMemory);
+
+	// WASM_EDITOR_RECORD=<file> records the session's keystrokes
+	char *record = getenv("WASM_EDITOR_RECORD");
+	if (record && record[0] && !vtermActive() &&
+			recordStart(record, rows, cols) == -1) die("recordStart");
+
+	// WASM_EDITOR_INTERN=1 shares the text of repeated lines, see intern.h
+	char *intern = getenv("WASM_EDITOR_INTERN");
+	if (intern && intern[0]) editorInternStart(&E);
+}
+
+// print the per-keystroke latencies and the phase histograms of a replay
+void editorReplayReport() {
+	replayReport();
+	statsDump(&stats, stdout);
+}
+
+// feed a recording through the editor against the virtual terminal
+void editorReplay() {
+	atexit(editorReplayReport); // a replayed Ctrl-Q exits early
+	editorRefreshScreen();
+	while (vtermPending()) {
+		editorProcessKeypress();
+		editorRefreshScreen();
+	}
+	exit(0);
 }
 
 int main(int argc, char *argv[]) {
+	// usage: editor [--replay <recording> [--fast]] [--follow] [file | -]
+	char *replay = NULL;
+	int fast = 0;
+	int follow = 0;
+	int argi = 1;
+	while (argi < argc && argv[argi][0] == '-' && argv[argi][1] == '-') {
+		if (!strcmp(argv[argi], "--replay") && argi + 1 < argc) {
+			replay = argv[++argi];
+		} else if (!strcmp(argv[argi], "--fast")) {
+			fast = 1;
+		} else if (!strcmp(argv[argi], "--follow")) {
+			follow = 1;
+		} else {
+			fprintf(stderr, "usage: %s [--replay <recording> [--fast]] [--follow] [file | -]\n",
+				argv[0]);
+			return 1;
+		}
+		argi++;
+	}
+	if (replay && replayLoad(replay, !fast) == -1) {
+		perror(replay);
+		return 1;
+	}
+
+	// text piped in (or "-") is followed, keys then come from the terminal
+	char *file = argi < argc ? argv[argi] : NULL;
+	int from_stdin = file ? !strcmp(file, "-") : !replay && !isatty(STDIN_FILENO);
+	int input = -1;
+	if (from_stdin) {
+		int tty = open("/dev/tty", O_RDWR);
+		if (tty == -1 || (input = dup(STDIN_FILENO)) == -1 ||
+				dup2(tty, STDIN_FILENO) == -1) {
+			perror("/dev/tty");
+			return 1;
+		}
+		close(tty);
+	}
+
 	enableRawMode();
 	initEditor();
-	if (argc >= 2) {
-		editorOpen(argv[1]);
+	if (from_stdin) {
+		if (editorFollowStart(&E, input) == -1) die("editorFollowStart");
+	} else if (file) {
+		// a FIFO can only be followed, reading it to the end would block
+		struct stat st;
+		if (!follow && stat(file, &st) == 0 && S_ISFIFO(st.st_mode)) follow = 1;
+		// a replay reads the whole file first, so it always sees the same rows
+		int ret = follow ? editorOpenFollow(&E, file) :
+			replay ? editorOpen(&E, file) : editorOpenProgressive(&E, file);
+		if (ret == -1) die("fopen");
 	}
-	editorSetStatusMessage("HELP: Ctrl-S = save | Ctrl-Q = quit | Ctrl-F = find");
+	if (replay) editorReplay();
+	// keep what opening the file had to say
+	if (E.statusmsg[0] == '\0')
+		editorSetStatusMessage(&E, "HELP: ^S save ^Q quit ^F find ^R replace ^G/^B goto ^N complete ^P pair ^W wrap");
 	while (1) {
 		editorRefreshScreen();
+		editorWaitKey();
 		editorProcessKeypress();
 	};
 	return 0;
@@ -0,0 +1,9 @@
+#ifndef __MAIN_H__
+#define __MAIN_H__
+
+#include "structs.h"
+
+// the editor context driven by the terminal front end
+extern struct editorConfig E;
+
+#endif
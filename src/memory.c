@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "memory.h"
+
+// prepended to every allocation, sized so the caller's pointer keeps
+// malloc's alignment
+union memHeader {
+	struct {
+		size_t size;
+		enum EDITOR_MEM tag;
+	} h;
+	long double align_ld;
+	long long align_ll;
+	void *align_p;
+};
+
+static const char *mem_names[MEM_COUNT] = {
+	"chars", "render", "hl", "rows", "frame", "search", "fileio", "cold", "words", "intern", "hlcache", "diff"
+};
+
+// short names for the message bar summary
+static const char *mem_short[MEM_COUNT] = {
+	"ch", "re", "hl", "ro", "fr", "se", "io", "co", "wo", "in", "hc", "di"
+};
+
+// index MEM_COUNT holds the totals
+static size_t live[MEM_COUNT + 1];
+static size_t peak[MEM_COUNT + 1];
+
+static void memRaisePeak(int i, size_t now) {
+	size_t old = __atomic_load_n(&peak[i], __ATOMIC_RELAXED);
+	while (now > old &&
+		!__atomic_compare_exchange_n(&peak[i], &old, now, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+static void memCharge(enum EDITOR_MEM tag, size_t size) {
+	memRaisePeak(tag, __atomic_add_fetch(&live[tag], size, __ATOMIC_RELAXED));
+	memRaisePeak(MEM_COUNT, __atomic_add_fetch(&live[MEM_COUNT], size, __ATOMIC_RELAXED));
+}
+
+static void memRefund(enum EDITOR_MEM tag, size_t size) {
+	__atomic_sub_fetch(&live[tag], size, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&live[MEM_COUNT], size, __ATOMIC_RELAXED);
+}
+
+void *memAlloc(enum EDITOR_MEM tag, size_t size) {
+	union memHeader *hdr = malloc(sizeof(union memHeader) + size);
+	if (hdr == NULL) return NULL;
+	hdr->h.size = size;
+	hdr->h.tag = tag;
+	memCharge(tag, size);
+	return hdr + 1;
+}
+
+void *memRealloc(enum EDITOR_MEM tag, void *ptr, size_t size) {
+	if (ptr == NULL) return memAlloc(tag, size);
+	union memHeader *hdr = (union memHeader *)ptr - 1;
+	size_t old_size = hdr->h.size;
+	enum EDITOR_MEM old_tag = hdr->h.tag;
+	hdr = realloc(hdr, sizeof(union memHeader) + size);
+	if (hdr == NULL) return NULL;
+	memRefund(old_tag, old_size);
+	hdr->h.size = size;
+	hdr->h.tag = tag;
+	memCharge(tag, size);
+	return hdr + 1;
+}
+
+void memFree(void *ptr) {
+	if (ptr == NULL) return;
+	union memHeader *hdr = (union memHeader *)ptr - 1;
+	memRefund(hdr->h.tag, hdr->h.size);
+	free(hdr);
+}
+
+size_t memLive(enum EDITOR_MEM tag) {
+	return __atomic_load_n(&live[tag], __ATOMIC_RELAXED);
+}
+
+size_t memPeak(enum EDITOR_MEM tag) {
+	return __atomic_load_n(&peak[tag], __ATOMIC_RELAXED);
+}
+
+void memFormatBytes(char *buf, size_t len, size_t bytes) {
+	if (bytes < 1024) snprintf(buf, len, "%zu", bytes);
+	else if (bytes < 1024 * 1024) snprintf(buf, len, "%.1fK", bytes / 1024.0);
+	else if (bytes < 1024 * 1024 * 1024) snprintf(buf, len, "%.1fM", bytes / (1024.0 * 1024));
+	else snprintf(buf, len, "%.1fG", bytes / (1024.0 * 1024 * 1024));
+}
+
+void memSummary(char *buf, size_t len) {
+	char num[16], pk[16];
+	memFormatBytes(num, sizeof(num), memLive(MEM_COUNT));
+	memFormatBytes(pk, sizeof(pk), memPeak(MEM_COUNT));
+	int n = snprintf(buf, len, "mem %s pk %s |", num, pk);
+	for (int i = 0; i < MEM_COUNT && n >= 0 && (size_t)n < len; i++) {
+		memFormatBytes(num, sizeof(num), memLive(i));
+		n += snprintf(buf + n, len - n, " %s %s", mem_short[i], num);
+	}
+}
+
+void memDump(FILE *fp) {
+	for (int i = 0; i <= MEM_COUNT; i++) {
+		fprintf(fp, "%s: live=%zu peak=%zu\n",
+			i == MEM_COUNT ? "total" : mem_names[i], memLive(i), memPeak(i));
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef __MEMORY_H__
+#define __MEMORY_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include "enums.h"
+
+// allocation wrappers that account every byte to a subsystem.
+// Counters are process wide and atomic, so they cover every editor
+// context and any thread. Memory from memAlloc/memRealloc must be
+// released with memFree (never plain free)
+
+// allocate size bytes charged to tag
+void *memAlloc(enum EDITOR_MEM tag, size_t size);
+
+// resize an allocation (ptr may be NULL) charged to tag
+void *memRealloc(enum EDITOR_MEM tag, void *ptr, size_t size);
+
+// free an allocation made by memAlloc/memRealloc (ptr may be NULL)
+void memFree(void *ptr);
+
+// bytes currently allocated for a subsystem (MEM_COUNT for the total)
+size_t memLive(enum EDITOR_MEM tag);
+
+// most bytes ever allocated at once for a subsystem (MEM_COUNT for the total)
+size_t memPeak(enum EDITOR_MEM tag);
+
+// format a byte count for humans ("512", "12.3K", "4.5M", "1.2G")
+void memFormatBytes(char *buf, size_t len, size_t bytes);
+
+// one-line live usage summary that fits in the message bar
+void memSummary(char *buf, size_t len);
+
+// write live and peak bytes of every subsystem
+void memDump(FILE *fp);
+
+#endif
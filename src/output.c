@@ -4,6 +4,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <stdint.h>
 
 #include "enums.h"
 #include "constants.h"
@@ -11,38 +12,177 @@
 #include "highlight.h"
 #include "buffer.h"
 #include "row.h"
+#include "output.h"
+#include "stats.h"
+#include "editor.h"
+#include "follow.h"
+#include "cold.h"
+#include "intern.h"
+#include "utf8.h"
+#include "brackets.h"
+#include "wrap.h"
+#include "diff.h"
 
-void editorScroll() {
-	E.rx = 0;
-	if (E.cy < E.numrows) {
-		E.rx = editorRowCxToRx(&E.row[E.cy], E.cx);
+int editorTextCols(struct editorConfig *E) {
+	int cols = E->screencols - editorDiffGutter(E);
+	return cols > 0 ? cols : 0;
+}
+
+void editorScroll(struct editorConfig *E) {
+	E->rx = 0;
+	if (E->cy < E->numrows) {
+		editorColdThaw(E, &E->row[E->cy]);
+		E->rx = editorRowCxToRx(&E->row[E->cy], E->cx);
+	}
+	if (E->wrap.on) {
+		editorWrapScroll(E);
+		return;
 	}
 
-	if (E.cy < E.rowoff) {
-		E.rowoff = E.cy;
+	if (E->cy < E->rowoff) {
+		E->rowoff = E->cy;
 	}
-	if (E.cy >= E.rowoff + E.screenrows) {
-		E.rowoff = E.cy - E.screenrows + 1;
+	if (E->cy >= E->rowoff + E->screenrows) {
+		E->rowoff = E->cy - E->screenrows + 1;
 	}
-	if (E.rx < E.coloff) {
-		E.coloff = E.rx;
+	if (E->rx < E->coloff) {
+		E->coloff = E->rx;
 	}
-	if (E.rx >= E.coloff + E.screencols) {
-		E.coloff = E.rx - E.screencols + 1;
+	if (E->rx >= E->coloff + editorTextCols(E)) {
+		E->coloff = E->rx - editorTextCols(E) + 1;
 	}
 }
 
-void editorDrawRows(struct abuf *ab) {
+// draw the columns [coloff, coloff + editorTextCols) of a row that isn't all
+// ASCII, a code point at a time. A wide one cut by the left edge leaves
+// a blank, one cut by the right edge isn't drawn
+static void editorDrawRowUtf8(struct editorConfig *E, struct abuf *ab, erow *row, size_t coloff) {
+	unsigned char *hl;
+	char *c = editorRowRender(E, row, 0, row->rsize, &hl);
+	size_t col = 0, end = coloff + editorTextCols(E);
+	int current_color = -1;
+	size_t j = 0;
+	while (j < row->rsize && col < end) {
+		uint32_t cp;
+		size_t n = utf8Decode(&c[j], row->rsize - j, &cp);
+		size_t w = utf8Width(cp);
+		if (col < coloff) {
+			for (size_t k = coloff; k < col + w; k++) abAppend(ab, " ", 1);
+		} else if (col + w > end) {
+			break;
+		} else if (cp < 0x20 || (cp >= 0x7f && cp < 0xa0) || cp == UTF8_INVALID) {
+			// control characters and bytes that aren't UTF-8
+			char sym = (cp <= 26) ? '@' + cp : '?';
+			abAppend(ab, "\x1b[7m", 4);
+			abAppend(ab, &sym, 1);
+			abAppend(ab, "\x1b[m", 3);
+			if (current_color != -1) {
+				char buf[16];
+				int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", current_color);
+				abAppend(ab, buf, clen);
+			}
+		} else if (hl[j] == HL_NORMAL) {
+			if (current_color != -1) {
+				abAppend(ab, "\x1b[39m", 5);
+				current_color = -1;
+			}
+			abAppend(ab, &c[j], n);
+		} else {
+			int color = editorSyntaxToColor(hl[j]);
+			if (color != current_color) {
+				current_color = color;
+				char buf[16];
+				int clen = snprintf(buf, sizeof(buf), "\x1b[%dm", color);
+				abAppend(ab, buf, clen);
+			}
+			abAppend(ab, &c[j], n);
+		}
+		col += w;
+		j += n;
+	}
+	abAppend(ab, "\x1b[39m", 5);
+}
+
+// the bracket under the cursor and its match, marked like a search
+// match in the rows on screen while they're drawn
+struct bracketMark {
+	size_t n;
+	size_t row[2], at[2]; // where in render
+	unsigned char hl[2]; // what was there
+};
+
+static void editorMarkBrackets(struct editorConfig *E, struct bracketMark *m) {
+	m->n = 0;
+	size_t bx, my, mx;
+	if (!editorBracketMatch(E, E->cy, E->cx, &bx, &my, &mx)) return;
+	size_t rows[2] = { E->cy, my }, cxs[2] = { bx, mx };
+	for (size_t k = 0; k < 2; k++) {
+		if (rows[k] < E->rowoff || rows[k] >= E->rowoff + E->screenrows) continue;
+		erow *row = &E->row[rows[k]];
+		editorColdThaw(E, row);
+		editorInternUnshare(row);
+		m->row[m->n] = rows[k];
+		m->at[m->n] = editorRowCxToRender(row, cxs[k]);
+		m->hl[m->n] = row->hl[m->at[m->n]];
+		row->hl[m->at[m->n]] = HL_MATCH;
+		m->n++;
+	}
+}
+
+// the gutter's column of a screen line, marked if it's the first line of
+// a row (or the one after the last)
+static void editorDrawGutter(struct editorConfig *E, struct abuf *ab, size_t filerow, int first) {
+	switch (first ? editorDiffMark(E, filerow) : ' ') {
+	case '+':
+		abAppend(ab, "\x1b[32m+\x1b[39m", 11);
+		break;
+	case '~':
+		abAppend(ab, "\x1b[33m~\x1b[39m", 11);
+		break;
+	case '-':
+		abAppend(ab, "\x1b[31m-\x1b[39m", 11);
+		break;
+	default:
+		abAppend(ab, " ", 1);
+	}
+}
+
+static void editorUnmarkBrackets(struct editorConfig *E, struct bracketMark *m) {
+	while (m->n > 0) {
+		m->n--;
+		E->row[m->row[m->n]].hl[m->at[m->n]] = m->hl[m->n];
+	}
+}
+
+void editorDrawRows(struct editorConfig *E, struct abuf *ab) {
+	uint64_t start = E->stats ? statsNow() : 0;
+	struct bracketMark mark;
+	editorMarkBrackets(E, &mark);
 	int y;
-	for (y = 0; y < E.screenrows; y++) {
-		int filerow = y + E.rowoff;
-		if (filerow >= E.numrows) {
-			if (E.numrows == 0 && y == E.screenrows / 3) {
+	size_t filerow = E->rowoff, line = E->wrap.lineoff, marked = SIZE_MAX;
+	int cols = editorTextCols(E);
+	for (y = 0; y < E->screenrows; y++) {
+		// the columns of the row on this line: from coloff, or with soft
+		// wrap the row's next visual line (or the next row's first)
+		size_t coloff = E->coloff;
+		if (!E->wrap.on) {
+			filerow = y + E->rowoff;
+		} else if (filerow < E->numrows) {
+			if (line >= editorWrapLines(E, &E->row[filerow])) {
+				filerow++;
+				line = 0;
+			}
+			if (filerow < E->numrows) coloff = editorWrapStart(E, &E->row[filerow], line++);
+		}
+		if (editorDiffGutter(E)) editorDrawGutter(E, ab, filerow, filerow != marked);
+		marked = filerow;
+		if (filerow >= E->numrows) {
+			if (E->numrows == 0 && y == E->screenrows / 3) {
 				char welcome[80];
 				int welcomelen = snprintf(welcome, sizeof(welcome),
 					"wasm-editor -- version %s", EDITOR_VERSION);
-				if (welcomelen > E.screencols) welcomelen = E.screencols;
-				int padding = (E.screencols - welcomelen) / 2;
+				if (welcomelen > cols) welcomelen = cols;
+				int padding = (cols - welcomelen) / 2;
 				if (padding) {
 					abAppend(ab, "~", 1);
 					padding--;
@@ -52,15 +192,16 @@ void editorDrawRows(struct abuf *ab) {
 			} else {
 				abAppend(ab, "~", 1);
 			}
+		} else if (!E->row[filerow].ascii) {
+			editorDrawRowUtf8(E, ab, &E->row[filerow], coloff);
 		} else {
-			int len = E.row[filerow].rsize - E.coloff;
-			if (len < 0) len = 0;
-			if (len > E.screencols) len = E.screencols;
-			// abAppend(ab, &E.row[filerow].render[E.coloff], len);
-			char *c = &E.row[filerow].render[E.coloff];
-			unsigned char *hl = &E.row[filerow].hl[E.coloff];
+			size_t len = 0;
+			if (E->row[filerow].rsize > coloff) len = E->row[filerow].rsize - coloff;
+			if (len > (size_t)cols) len = cols;
+			unsigned char *hl;
+			char *c = editorRowRender(E, &E->row[filerow], coloff, len, &hl);
 			int current_color = -1;
-			int j;
+			size_t j;
 			for (j = 0; j < len; j++) {
 				if (iscntrl(c[j])) {
 					char sym = (c[j] <= 26) ? '@' + c[j] : '?';
@@ -95,21 +236,39 @@ void editorDrawRows(struct abuf *ab) {
 		abAppend(ab, "\x1b[K", 3);
 		abAppend(ab, "\r\n", 2);
 	}
+	editorUnmarkBrackets(E, &mark);
+	statsPhase(E->stats, STAT_DRAW_ROWS, start);
 }
 
-void editorDrawStatusBar(struct abuf *ab) {
+void editorDrawStatusBar(struct editorConfig *E, struct abuf *ab) {
 	// append a row with inverted colors (7)
 	abAppend(ab, "\x1b[7m", 4);
 	char status[80], rstatus[80];
-	int len = snprintf(status, sizeof(status), "%.20s - %d lines %s",
-		E.filename ? E.filename : "[No Name]", E.numrows,
-		E.dirty ? "(modified)" : "");
-	int rlen = snprintf(rstatus, sizeof(rstatus), "%s | %d/%d",
-		E.syntax ? E.syntax->filetype : "no ft", E.cy + 1, E.numrows);
-	if (len > E.screencols) len = E.screencols;
+	int len;
+	if (E->stats && E->stats->overlay) {
+		// keystroke-to-paint latency in place of the file name
+		struct editorHistogram *h = &E->stats->hist[STAT_KEY_TO_PAINT];
+		char p50[16], p99[16];
+		statsFormatNs(p50, sizeof(p50), statsPercentile(h, 0.5));
+		statsFormatNs(p99, sizeof(p99), statsPercentile(h, 0.99));
+		len = snprintf(status, sizeof(status), "key->paint p50 %s p99 %s (%llu keys)",
+			p50, p99, (unsigned long long)h->total);
+	} else if (editorFollowProgress(E) != -1) {
+		len = snprintf(status, sizeof(status), "%.20s - %zu lines (loading %d%%) %s",
+			E->filename ? E->filename : "[No Name]", E->numrows, editorFollowProgress(E),
+			E->dirty ? "(modified)" : "");
+	} else {
+		len = snprintf(status, sizeof(status), "%.20s - %zu lines %s",
+			E->filename ? E->filename : "[No Name]", E->numrows,
+			E->dirty ? "(modified)" : "");
+	}
+	int rlen = snprintf(rstatus, sizeof(rstatus), "%s | %zu/%zu | @%zu",
+		E->syntax ? E->syntax->filetype : "no ft", E->cy + 1, E->numrows,
+		editorCursorOffset(E));
+	if (len > E->screencols) len = E->screencols;
 	abAppend(ab, status, len);
-	while (len < E.screencols) {
-		if (E.screencols - len == rlen) {
+	while (len < E->screencols) {
+		if (E->screencols - len == rlen) {
 			abAppend(ab, rstatus, rlen);
 			break;
 		} else {
@@ -121,48 +280,47 @@ void editorDrawStatusBar(struct abuf *ab) {
 	abAppend(ab, "\r\n", 2);
 }
 
-void editorDrawMessageBar(struct abuf *ab) {
+void editorDrawMessageBar(struct editorConfig *E, struct abuf *ab) {
 	abAppend(ab, "\x1b[K", 3);
-	int msglen = strlen(E.statusmsg);
-	if (msglen > E.screencols) msglen = E.screencols;
+	size_t msglen = strlen(E->statusmsg);
+	if (msglen > (size_t)E->screencols) msglen = E->screencols;
 	// disappear when you press a key after five seconds
-	if (msglen && time(NULL) - E.statusmsg_time < 5)
-		abAppend(ab, E.statusmsg, msglen);
+	if (msglen && time(NULL) - E->statusmsg_time < 5)
+		abAppend(ab, E->statusmsg, msglen);
 }
 
-void editorRefreshScreen() {
-	editorScroll();
-	struct abuf ab = ABUF_INIT;
+void editorDrawScreen(struct editorConfig *E, struct abuf *ab) {
+	editorScroll(E);
 	// write escape sequence to terminal
 	// 2J clears the entire screen - 1J up to cursor, 0J after cursor
 	// (commented because we're clearing each line instead)
-	// abAppend(&ab, "\x1b[2J", 4);
+	// abAppend(ab, "\x1b[2J", 4);
 	// 3 byte escape sequence to reposition cursor to 1:1 (same as \x1b[1;1H)
-	abAppend(&ab, "\x1b[?25l", 6);
-	abAppend(&ab, "\x1b[H", 3);
+	abAppend(ab, "\x1b[?25l", 6);
+	abAppend(ab, "\x1b[H", 3);
 	// draw tildes to start each row
-	editorDrawRows(&ab);
+	editorDrawRows(E, ab);
 	// draw bottom status bar
-	editorDrawStatusBar(&ab);
-	editorDrawMessageBar(&ab);
+	editorDrawStatusBar(E, ab);
+	editorDrawMessageBar(E, ab);
 
 	// move the cursor to the correct position after refresh
 	char buf[32];
-	snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (E.cy - E.rowoff) + 1, (E.rx - E.coloff) + 1);
-	abAppend(&ab, buf, strlen(buf));
+	size_t gutter = editorDiffGutter(E);
+	if (E->wrap.on) snprintf(buf, sizeof(buf), "\x1b[%zu;%zuH", E->wrap.y + 1, E->wrap.x + gutter + 1);
+	else snprintf(buf, sizeof(buf), "\x1b[%zu;%zuH", (E->cy - E->rowoff) + 1, (E->rx - E->coloff) + gutter + 1);
+	abAppend(ab, buf, strlen(buf));
 
 	// reposition cursor
-	abAppend(&ab, "\x1b[?25h", 6);
-	write(STDOUT_FILENO, ab.b, ab.len);
-	abFree(&ab);
+	abAppend(ab, "\x1b[?25h", 6);
 }
 
 // variadic function that can take any number of arguments
 // va_arg helps get those arguments
-void editorSetStatusMessage(const char *fmt, ...) {
+void editorSetStatusMessage(struct editorConfig *E, const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
-	vsnprintf(E.statusmsg, sizeof(E.statusmsg), fmt, ap);
+	vsnprintf(E->statusmsg, sizeof(E->statusmsg), fmt, ap);
 	va_end(ap);
-	E.statusmsg_time = time(NULL);
+	E->statusmsg_time = time(NULL);
 }
\ No newline at end of file
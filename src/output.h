@@ -1,26 +1,31 @@
 #ifndef __OUTPUT_H__
 #define __OUTPUT_H__
 
+#include "structs.h"
 #include "buffer.h"
 
 // handle vertical and horizontal scrolling
 // based on cursor position
-void editorScroll();
+void editorScroll(struct editorConfig *E);
+
+// columns left for the text, right of the diff gutter
+int editorTextCols(struct editorConfig *E);
 
 // draw rows when opening editor
-void editorDrawRows(struct abuf *ab);
+void editorDrawRows(struct editorConfig *E, struct abuf *ab);
 
 // draw status bar at bottom of editor
-void editorDrawStatusBar(struct abuf *ab);
+void editorDrawStatusBar(struct editorConfig *E, struct abuf *ab);
 
 // draw message bar below status bar
-void editorDrawMessageBar(struct abuf *ab);
+void editorDrawMessageBar(struct editorConfig *E, struct abuf *ab);
 
-// refresh screen (redraw all rows and init)
-void editorRefreshScreen();
+// draw a whole frame (rows, bars and cursor) into ab,
+// ready to be written to a terminal
+void editorDrawScreen(struct editorConfig *E, struct abuf *ab);
 
 // variadic function that can take any number of arguments
 // va_arg helps get those arguments
-void editorSetStatusMessage(const char *fmt, ...);
+void editorSetStatusMessage(struct editorConfig *E, const char *fmt, ...);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "record.h"
+#include "stats.h"
+#include "vterm.h"
+
+#define RECORD_MAGIC "wasm-editor-recording 1"
+
+static FILE *record_fp;
+static uint64_t record_start;
+
+// latencies of replayed keys, in the order they were painted
+static struct {
+	int active;
+	int *keys;
+	uint64_t *ns;
+	size_t len, cap;
+} R;
+
+int recordStart(const char *path, int rows, int cols) {
+	record_fp = fopen(path, "w");
+	if (record_fp == NULL) return -1;
+	// a line at a time, so a crash or kill still leaves a usable recording
+	setvbuf(record_fp, NULL, _IOLBF, 0);
+	fprintf(record_fp, "%s\nsize %d %d\n", RECORD_MAGIC, rows, cols);
+	return 0;
+}
+
+void recordKey(int key) {
+	if (record_fp == NULL) return;
+	uint64_t now = statsNow();
+	if (record_start == 0) record_start = now;
+	fprintf(record_fp, "%llu %d\n", (unsigned long long)(now - record_start), key);
+}
+
+int replayLoad(const char *path, int paced) {
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) return -1;
+
+	char magic[64];
+	int rows, cols;
+	if (fgets(magic, sizeof(magic), fp) == NULL ||
+			strncmp(magic, RECORD_MAGIC, strlen(RECORD_MAGIC)) ||
+			fscanf(fp, "size %d %d", &rows, &cols) != 2) {
+		fclose(fp);
+		return -1;
+	}
+	vtermEnable(rows, cols);
+	vtermSetPacing(paced);
+
+	unsigned long long at;
+	int key;
+	while (fscanf(fp, "%llu %d", &at, &key) == 2)
+		vtermPushTimedKey(key, at);
+	fclose(fp);
+	R.active = 1;
+	return 0;
+}
+
+void replayKeyPainted(int key, uint64_t ns) {
+	if (!R.active) return;
+	if (R.len == R.cap) {
+		size_t cap = R.cap ? R.cap * 2 : 256;
+		int *keys = realloc(R.keys, sizeof(int) * cap);
+		if (keys == NULL) return;
+		R.keys = keys;
+		uint64_t *lat = realloc(R.ns, sizeof(uint64_t) * cap);
+		if (lat == NULL) return;
+		R.ns = lat;
+		R.cap = cap;
+	}
+	R.keys[R.len] = key;
+	R.ns[R.len] = ns;
+	R.len++;
+}
+
+void replayReport() {
+	if (!R.active) return;
+	printf("keystrokes: %zu\n", R.len);
+	for (size_t i = 0; i < R.len; i++)
+		printf("  %zu key=%d latency_ns=%llu\n", i, R.keys[i], (unsigned long long)R.ns[i]);
+}
@@ -0,0 +1,30 @@
+#ifndef __RECORD_H__
+#define __RECORD_H__
+
+#include <stdint.h>
+
+// keystroke session recording and replay. A recording is a text file:
+//
+//   wasm-editor-recording 1
+//   size <rows> <cols>
+//   <nanoseconds since the first key> <key>
+//   ...
+
+// start appending every key read from the terminal to a recording,
+// returns -1 if the file can't be created
+int recordStart(const char *path, int rows, int cols);
+
+// log a decoded key (does nothing unless recording)
+void recordKey(int key);
+
+// load a recording into the virtual terminal (switching it on with the
+// recorded window size), returns -1 on error
+int replayLoad(const char *path, int paced);
+
+// note the keystroke-to-paint latency of a replayed key
+void replayKeyPainted(int key, uint64_t ns);
+
+// print per-keystroke latencies collected during replay to stdout
+void replayReport();
+
+#endif
@@ -5,10 +5,43 @@
 #include "enums.h"
 #include "filetypes.h"
 #include "highlight.h"
+#include "row.h"
+#include "memory.h"
+#include "longrow.h"
+#include "counts.h"
+#include "cold.h"
+#include "intern.h"
+#include "utf8.h"
+#include "stats.h"
+#include "words.h"
+#include "brackets.h"
+#include "wrap.h"
+#include "diff.h"
 
-int editorRowCxToRx(erow *row, int cx) {
-	int rx = 0;
-	int j;
+// columns the code point at chars[j] takes starting at column rx, and
+// its length in *n
+static size_t editorRowColumns(erow *row, size_t j, size_t rx, size_t *n) {
+	if (row->chars[j] == '\t') {
+		*n = 1;
+		return EDITOR_TAB_STOP - rx % EDITOR_TAB_STOP;
+	}
+	uint32_t cp;
+	*n = utf8Decode(&row->chars[j], row->size - j, &cp);
+	return utf8Width(cp);
+}
+
+size_t editorRowCxToRx(erow *row, size_t cx) {
+	if (row->chunks) return longRowCxToRx(row, cx);
+	size_t rx = 0;
+	size_t j;
+	if (!row->ascii) {
+		for (j = 0; j < cx && j < row->size; ) {
+			size_t n;
+			rx += editorRowColumns(row, j, rx, &n);
+			j += n;
+		}
+		return rx;
+	}
 	for (j = 0; j < cx; j++) {
 		if (row->chars[j] == '\t')
 			rx += (EDITOR_TAB_STOP - 1) - (rx % EDITOR_TAB_STOP);
@@ -17,12 +50,22 @@ int editorRowCxToRx(erow *row, int cx) {
 	return rx;
 }
 
-int editorRowRxToCx(erow *row, int rx) {
-	int cur_rx = 0;
-	int cx;
+size_t editorRowRxToCx(erow *row, size_t rx) {
+	if (row->chunks) return longRowRxToCx(row, rx);
+	size_t cur_rx = 0;
+	size_t cx;
+	if (!row->ascii) {
+		for (cx = 0; cx < row->size; ) {
+			size_t n;
+			cur_rx += editorRowColumns(row, cx, cur_rx, &n);
+			if (cur_rx > rx) return cx;
+			cx += n;
+		}
+		return cx;
+	}
 	for (cx = 0; cx < row->size; cx++) {
 		if (row->chars[cx] == '\t')
-			cur_rx += (EDITOR_TAB_STOP - 1) - (cur_rx & EDITOR_TAB_STOP);
+			cur_rx += (EDITOR_TAB_STOP - 1) - (cur_rx % EDITOR_TAB_STOP);
 		cur_rx++;
 
 		if (cur_rx > rx) return cx;
@@ -30,17 +73,154 @@ int editorRowRxToCx(erow *row, int rx) {
 	return cx;
 }
 
-void editorUpdateRow(erow *row) {
-	int tabs = 0;
-	int j;
+size_t editorRowCxToRender(erow *row, size_t cx) {
+	if (row->ascii) return editorRowCxToRx(row, cx);
+	size_t rx = 0, idx = 0;
+	for (size_t j = 0; j < cx && j < row->size; ) {
+		size_t n;
+		size_t cols = editorRowColumns(row, j, rx, &n);
+		idx += row->chars[j] == '\t' ? cols : n;
+		rx += cols;
+		j += n;
+	}
+	return idx;
+}
+
+size_t editorRowRenderToCx(erow *row, size_t at) {
+	if (row->ascii) return editorRowRxToCx(row, at);
+	// render holds the chars with tabs expanded to spaces
+	size_t rx = 0, idx = 0;
+	size_t cx;
+	for (cx = 0; cx < row->size; ) {
+		size_t n;
+		size_t cols = editorRowColumns(row, cx, rx, &n);
+		rx += cols;
+		idx += row->chars[cx] == '\t' ? cols : n;
+		if (idx > at) return cx;
+		cx += n;
+	}
+	return cx;
+}
+
+// whether the code point at chars[cx] takes no column (a combining mark
+// belongs with the code point before it)
+static int editorRowZeroWidth(const char *chars, size_t size, size_t cx) {
+	uint32_t cp;
+	if (cx >= size) return 0;
+	utf8Decode(&chars[cx], size - cx, &cp);
+	return utf8Width(cp) == 0;
+}
+
+size_t editorRowPrevCx(struct editorConfig *E, erow *row, size_t cx) {
+	if (cx == 0) return 0;
+	if (row->ascii) return cx - 1;
+	const char *chars = editorColdChars(E, row);
+	do {
+		cx = utf8Prev(chars, row->size, cx);
+	} while (cx > 0 && editorRowZeroWidth(chars, row->size, cx));
+	return cx;
+}
+
+size_t editorRowNextCx(struct editorConfig *E, erow *row, size_t cx) {
+	if (cx >= row->size) return row->size;
+	if (row->ascii) return cx + 1;
+	const char *chars = editorColdChars(E, row);
+	do {
+		cx = utf8Next(chars, row->size, cx);
+	} while (editorRowZeroWidth(chars, row->size, cx));
+	return cx;
+}
+
+size_t editorRowSnapCx(struct editorConfig *E, erow *row, size_t cx) {
+	if (row->ascii) return cx;
+	const char *chars = editorColdChars(E, row);
+	cx = utf8Snap(chars, row->size, cx);
+	while (cx > 0 && editorRowZeroWidth(chars, row->size, cx))
+		cx = utf8Prev(chars, row->size, cx);
+	return cx;
+}
+
+size_t editorRowOffset(struct editorConfig *E, size_t at) {
+	return countsPrefix(&E->offsets, at);
+}
+
+size_t editorRowAtOffset(struct editorConfig *E, size_t offset) {
+	return countsSearch(&E->offsets, offset);
+}
+
+// grow the range of rows [*first, *last] (none if first > last) to at
+static void editorRangeAdd(size_t *first, size_t *last, size_t at) {
+	if (*first > *last) {
+		*first = *last = at;
+	} else {
+		if (at < *first) *first = at;
+		if (at > *last) *last = at;
+	}
+}
+
+// keep a range of rows on the same rows when the del rows from at are
+// replaced by count new ones, those among the replaced ones go to at
+static void editorRangeMove(size_t *first, size_t *last, size_t at, size_t del, size_t count) {
+	if (*first > *last) return;
+	if (*first >= at + del) *first += count - del;
+	else if (*first > at) *first = at;
+	if (*last >= at + del) *last += count - del;
+	else if (*last > at) *last = at;
+}
+
+// remember that row at changed for the next save
+static void editorRowMark(struct editorConfig *E, size_t at) {
+	editorRangeAdd(&E->save.first, &E->save.last, at);
+	editorDiffChanged(E, at);
+	E->dirty++;
+}
+
+// move the changed and stale rows along with rows replaced (see above)
+static void editorRowMoveMarks(struct editorConfig *E, size_t at, size_t del, size_t count) {
+	editorRangeMove(&E->save.first, &E->save.last, at, del, count);
+	editorRangeMove(&E->edit.first, &E->edit.last, at, del, count);
+}
+
+// fill in the render string of a row from its chars, or split it into
+// chunks if it's long
+static void editorRenderRow(erow *row) {
+	row->wrap_gen = 0;
+	editorInternUnshare(row);
+	if (row->size >= EDITOR_LONG_ROW || (row->chunks && row->size >= EDITOR_LONG_ROW / 2)) {
+		// long rows count a byte as a column, whatever it is
+		row->ascii = 1;
+		longRowBuild(row);
+		return;
+	}
+	longRowFree(row);
+	row->ascii = utf8IsAscii(row->chars, row->size);
+
+	size_t tabs = 0;
+	size_t j;
 	for (j = 0; j < row->size; j++) {
 		if (row->chars[j] == '\t') tabs++;
 	}
 
-	free(row->render);
-	row->render = malloc(row->size + tabs*(EDITOR_TAB_STOP - 1) + 1);
+	memFree(row->render);
+	row->render = memAlloc(MEM_RENDER, row->size + tabs*(EDITOR_TAB_STOP - 1) + 1);
 
-	int idx = 0;
+	size_t idx = 0;
+	if (!row->ascii) {
+		// tabs go to the next tab stop in columns, not bytes
+		size_t rx = 0;
+		for (j = 0; j < row->size; ) {
+			size_t n;
+			size_t cols = editorRowColumns(row, j, rx, &n);
+			if (row->chars[j] == '\t') memset(&row->render[idx], ' ', cols);
+			else memcpy(&row->render[idx], &row->chars[j], n);
+			idx += row->chars[j] == '\t' ? cols : n;
+			rx += cols;
+			j += n;
+		}
+		row->render[idx] = '\0';
+		row->rsize = idx;
+		return;
+	}
 	for (j = 0; j < row->size; j++) {
 		if (row->chars[j]=='\t') {
 			row->render[idx++] = ' ';
@@ -51,72 +231,299 @@ void editorUpdateRow(erow *row) {
 	}
 	row->render[idx] = '\0';
 	row->rsize = idx;
+}
+
+void editorUpdateRow(struct editorConfig *E, erow *row) {
+	editorRenderRow(row);
+	editorUpdateSyntax(E, row);
+}
+
+void editorRowRestore(struct editorConfig *E, erow *row) {
+	editorRenderRow(row);
+	editorRelexRow(E, row);
+}
+
+// redo what a change left stale (ROW_STALE_*) in a row, or leave it for
+// editorCommitEdit inside an edit
+static void editorRowRefresh(struct editorConfig *E, erow *row, int stale) {
+	// a long row edited in place isn't rendered again
+	row->wrap_gen = 0;
+	if (E->edit.depth > 0) {
+		row->stale |= stale;
+		editorRangeAdd(&E->edit.first, &E->edit.last, row->idx);
+		return;
+	}
+	if (stale & ROW_STALE_RENDER) editorRenderRow(row);
+	editorUpdateSyntax(E, row);
+	if (row->stale & ROW_STALE_WORDS) editorWordsRow(E, row, 1);
+	row->stale = 0;
+}
+
+// get a row ready for its chars to change: thawed, and its words out of
+// the index until editorRowRefresh
+static void editorRowTouch(struct editorConfig *E, erow *row) {
+	editorColdThaw(E, row);
+	editorInternUnshare(row);
+	if (row->stale & ROW_STALE_WORDS) return;
+	editorWordsRow(E, row, -1);
+	row->stale |= ROW_STALE_WORDS;
+}
+
+// update a row after chars[at] was inserted (delta 1) or removed (-1),
+// a long row only redoes the chunk around at
+static void editorRowChanged(struct editorConfig *E, erow *row, size_t at, int delta) {
+	if (row->chunks && row->size >= EDITOR_LONG_ROW / 2) {
+		longRowEdit(row, at, delta);
+		editorRowRefresh(E, row, ROW_STALE_SYNTAX);
+	} else {
+		editorRowRefresh(E, row, ROW_STALE_RENDER | ROW_STALE_SYNTAX);
+	}
+}
 
-	editorUpdateSyntax(row);
+void editorBeginEdit(struct editorConfig *E) {
+	E->edit.depth++;
 }
 
-void editorInsertRow(int at, char *s, size_t len) {
-	if (at < 0 || at > E.numrows) return;
+void editorCommitEdit(struct editorConfig *E) {
+	struct editorEdit *t = &E->edit;
+	if (t->depth == 0 || --t->depth > 0) return;
+	if (t->first > t->last) return;
+
+	// each stale row once, top down, and the rows below while the exit
+	// state keeps changing
+	uint64_t start = E->stats ? statsNow() : 0;
+	int carry = 0;
+	for (size_t j = t->first; j < E->numrows && (j <= t->last || carry); j++) {
+		erow *row = &E->row[j];
+		if (row->stale & ROW_STALE_RENDER) editorRenderRow(row);
+		carry = row->stale || carry ? editorHighlightRow(E, row) : 0;
+		if (row->stale & ROW_STALE_WORDS) editorWordsRow(E, row, 1);
+		row->stale = 0;
+	}
+	statsPhase(E->stats, STAT_UPDATE_SYNTAX, start);
+	t->first = 1;
+	t->last = 0;
+}
+
+char *editorRowRender(struct editorConfig *E, erow *row, size_t rx, size_t len,
+		unsigned char **hl) {
+	editorColdThaw(E, row);
+	if (row->chunks) return longRowView(E->syntax, row, rx, len, hl);
+	*hl = &row->hl[rx];
+	return &row->render[rx];
+}
+
+// fill in the row in slot at, leaving rendering and highlighting to the
+// caller
+static void editorRowInit(struct editorConfig *E, size_t at, char *s, size_t len) {
+	E->row[at].idx = at;
+
+	E->row[at].size = len;
+	E->row[at].chars = memAlloc(MEM_CHARS, len + 1);
+	memcpy(E->row[at].chars, s, len);
+	E->row[at].chars[len] = '\0';
+
+	E->row[at].rsize = 0;
+	E->row[at].render = NULL;
+	E->row[at].hl = NULL;
+	// the row below was lexed following the row above, so start from that
+	// state to see whether the new row changes it
+	E->row[at].hl_open_comment = at > 0 ? E->row[at - 1].hl_open_comment : 0;
+	E->row[at].chunks = NULL;
+	E->row[at].cold = NULL;
+	E->row[at].shared = NULL;
+	E->row[at].ascii = utf8IsAscii(s, len);
+	E->row[at].stale = 0;
+	E->row[at].wrap_gen = 0;
+	memset(&E->row[at].brackets, 0, sizeof(E->row[at].brackets));
+	// a new row may be worth freezing or sharing some day
+	E->cold.left = E->numrows + 1;
+	if (E->intern.on) E->intern.left = E->numrows + 1;
+}
+
+// insert a row, leaving rendering and highlighting to the caller
+static void editorInsertRowRaw(struct editorConfig *E, size_t at, char *s, size_t len) {
+
+	E->row = memRealloc(MEM_ROWS, E->row, sizeof(erow) * (E->numrows + 1));
+	memmove(&E->row[at + 1], &E->row[at], sizeof(erow) * (E->numrows - at));
+	for (size_t j = at + 1; j <= E->numrows; j++) E->row[j].idx++;
 
-	E.row = realloc(E.row, sizeof(erow) * (E.numrows + 1));
-	memmove(&E.row[at + 1], &E.row[at], sizeof(erow) * (E.numrows - at));
-	for (int j = at + 1; j <= E.numrows; j++) E.row[j].idx++;
+	editorRowInit(E, at, s, len);
 
-	E.row[at].idx = at;
+	E->numrows++;
+	countsInsert(&E->offsets, at, len + 1);
+	editorBracketsReplace(E, at, 0, 1);
+	editorWrapMove(E, at, 0, 1);
+	editorDiffMove(E, at, 0, 1);
+}
 
-	E.row[at].size = len;
-	E.row[at].chars = malloc(len + 1);
-	memcpy(E.row[at].chars, s, len);
-	E.row[at].chars[len] = '\0';
+void editorInsertRow(struct editorConfig *E, size_t at, char *s, size_t len) {
+	if (at > E->numrows) return;
+	editorInsertRowRaw(E, at, s, len);
+	editorRowMoveMarks(E, at, 0, 1);
+	editorWordsMove(E, at, 0, 1);
+	E->row[at].stale |= ROW_STALE_WORDS;
+	editorRowRefresh(E, &E->row[at], ROW_STALE_RENDER | ROW_STALE_SYNTAX);
+	editorRowMark(E, at);
+}
 
-	E.row[at].rsize = 0;
-	E.row[at].render = NULL;
-	E.row[at].hl = NULL;
-	E.row[at].hl_open_comment = 0;
-	editorUpdateRow(&E.row[at]);
+void editorLoadRow(struct editorConfig *E, char *s, size_t len) {
+	editorInsertRowRaw(E, E->numrows, s, len);
+	editorRenderRow(&E->row[E->numrows - 1]);
+}
 
-	E.numrows++;
-	E.dirty++;
+void editorLoadRowsBare(struct editorConfig *E, const size_t *bytes, size_t count) {
+	size_t at = E->numrows;
+	E->row = memRealloc(MEM_ROWS, E->row, sizeof(erow) * (at + count ? at + count : 1));
+	// no chars, render, hl, chunks or marks; not known to be ASCII
+	memset(&E->row[at], 0, sizeof(erow) * count);
+	for (size_t j = 0; j < count; j++) {
+		E->row[at + j].idx = at + j;
+		E->row[at + j].size = bytes[j] - 1;
+	}
+	E->numrows += count;
+	countsReplace(&E->offsets, at, 0, bytes, count);
+	editorBracketsReplace(E, at, 0, count);
+	editorWrapMove(E, at, 0, count);
+	editorDiffMove(E, at, 0, count);
+	E->cold.left = E->numrows;
+	if (E->intern.on) E->intern.left = E->numrows;
 }
 
 void editorFreeRow(erow *row) {
-	free(row->render);
-	free(row->chars);
-	free(row->hl);
+	editorInternDrop(row);
+	memFree(row->render);
+	memFree(row->chars);
+	memFree(row->hl);
+	longRowFree(row);
+	editorColdDrop(row);
+}
+
+void editorDelRow(struct editorConfig *E, size_t at) {
+	if (at >= E->numrows) return;
+	if (!(E->row[at].stale & ROW_STALE_WORDS)) editorWordsRow(E, &E->row[at], -1);
+	editorFreeRow(&E->row[at]);
+	memmove(&E->row[at], &E->row[at + 1], sizeof(erow) * (E->numrows - at - 1));
+	for (size_t j = at; j < E->numrows - 1; j++) E->row[j].idx--;
+	E->numrows--;
+	countsDelete(&E->offsets, at);
+	editorBracketsReplace(E, at, 1, 0);
+	editorWrapMove(E, at, 1, 0);
+	editorDiffMove(E, at, 1, 0);
+	// the bytes after the deleted row's start all moved
+	editorRowMoveMarks(E, at, 1, 0);
+	editorWordsMove(E, at, 1, 0);
+	// the row that moved up follows a different row now
+	if (at < E->numrows) editorRowRefresh(E, &E->row[at], ROW_STALE_SYNTAX);
+	editorRowMark(E, at);
+}
+
+void editorReplaceRows(struct editorConfig *E, size_t at, size_t del, char **lines,
+		size_t *lens, size_t count) {
+	if (at > E->numrows) return;
+	if (del > E->numrows - at) del = E->numrows - at;
+	size_t numrows = E->numrows - del + count;
+
+	for (size_t j = at; j < at + del; j++) {
+		if (!(E->row[j].stale & ROW_STALE_WORDS)) editorWordsRow(E, &E->row[j], -1);
+		editorFreeRow(&E->row[j]);
+	}
+	if (count > del) E->row = memRealloc(MEM_ROWS, E->row, sizeof(erow) * numrows);
+	memmove(&E->row[at + count], &E->row[at + del], sizeof(erow) * (E->numrows - at - del));
+	for (size_t j = at + count; j < numrows; j++) E->row[j].idx = j;
+	E->numrows = numrows;
+
+	size_t *counts = malloc(sizeof(size_t) * (count ? count : 1));
+	for (size_t j = 0; j < count; j++) {
+		editorRowInit(E, at + j, lines[j], lens[j]);
+		editorRenderRow(&E->row[at + j]);
+		counts[j] = lens[j] + 1;
+	}
+	countsReplace(&E->offsets, at, del, counts, count);
+	editorBracketsReplace(E, at, del, count);
+	editorWrapMove(E, at, del, count);
+	editorDiffMove(E, at, del, count);
+	free(counts);
+
+	editorHighlightRows(E, at, at + count);
+	// with nothing inserted the row that moved up follows a different row
+	if (count == 0 && at < E->numrows) editorUpdateSyntax(E, &E->row[at]);
+
+	editorRowMoveMarks(E, at, del, count);
+	editorWordsMove(E, at, del, count);
+	for (size_t j = 0; j < count; j++) editorWordsRow(E, &E->row[at + j], 1);
+	editorRowMark(E, at);
+	if (count > 1) editorRowMark(E, at + count - 1);
 }
 
-void editorDelRow(int at) {
-	if (at < 0 || at >= E.numrows) return;
-	editorFreeRow(&E.row[at]);
-	memmove(&E.row[at], &E.row[at + 1], sizeof(erow) * (E.numrows - at - 1));
-	for (int j = at; j < E.numrows - 1; j++) E.row[j].idx--;
-	E.numrows--;
-	E.dirty++;
+void editorRowSwapChars(erow *row, char *chars, size_t len) {
+	editorInternDrop(row);
+	memFree(row->chars);
+	row->chars = chars;
+	row->size = len;
+	editorRenderRow(row);
 }
 
-void editorRowInsertChar(erow *row, int at, int c) {
-	if (at < 0 || at > row->size) at = row->size;
-	row->chars = realloc(row->chars, row->size + 2); // make room for null byte
+void editorRowsSwapped(struct editorConfig *E, const size_t *rows, size_t n) {
+	if (n == 0) return;
+	// the rows' old words went with their chars, the sweep starts over
+	editorWordsReset(E);
+	for (size_t k = 0; k < n; k++) {
+		countsSet(&E->offsets, rows[k], E->row[rows[k]].size + 1);
+		editorRowMark(E, rows[k]);
+	}
+	// rows close together are lexed in one parallel pass (the rows in
+	// between included), scattered ones one by one
+	size_t span = rows[n - 1] - rows[0] + 1;
+	if (n * EDITOR_SWAP_SPAN >= span) {
+		editorHighlightRows(E, rows[0], rows[n - 1] + 1);
+	} else {
+		for (size_t k = 0; k < n; k++) editorUpdateSyntax(E, &E->row[rows[k]]);
+	}
+}
+
+void editorRowInsertChar(struct editorConfig *E, erow *row, size_t at, int c) {
+	if (at > row->size) at = row->size;
+	editorRowTouch(E, row);
+	row->chars = memRealloc(MEM_CHARS, row->chars, row->size + 2); // make room for null byte
 	memmove(&row->chars[at + 1], &row->chars[at], row->size - at + 1);
 	row->size++;
 	row->chars[at] = c;
-	editorUpdateRow(row);
-	E.dirty++;
+	// a render (which may wait for the end of an edit) looks again
+	if ((unsigned char)c >= 0x80 && !row->chunks) row->ascii = 0;
+	countsAdd(&E->offsets, row->idx, 1);
+	editorRowChanged(E, row, at, 1);
+	editorRowMark(E, row->idx);
 }
 
-void editorRowAppendString(erow *row, char *s, size_t len) {
-	row->chars = realloc(row->chars, row->size + len + 1); // include null byte
+void editorRowAppendString(struct editorConfig *E, erow *row, char *s, size_t len) {
+	editorRowTouch(E, row);
+	row->chars = memRealloc(MEM_CHARS, row->chars, row->size + len + 1); // include null byte
 	memcpy(&row->chars[row->size], s, len);
 	row->size += len;
 	row->chars[row->size] = '\0';
-	editorUpdateRow(row);
-	E.dirty++;
+	if (!row->chunks && !utf8IsAscii(s, len)) row->ascii = 0;
+	countsAdd(&E->offsets, row->idx, len);
+	editorRowRefresh(E, row, ROW_STALE_RENDER | ROW_STALE_SYNTAX);
+	editorRowMark(E, row->idx);
 }
 
-void editorRowDelChar(erow *row, int at) {
-	if (at < 0 || at >= row->size) return;
+void editorRowDelChar(struct editorConfig *E, erow *row, size_t at) {
+	if (at >= row->size) return;
+	editorRowTouch(E, row);
 	memmove(&row->chars[at], &row->chars[at + 1], row->size - at);
 	row->size--;
-	editorUpdateRow(row);
-	E.dirty++;
-}
\ No newline at end of file
+	countsAdd(&E->offsets, row->idx, -1);
+	editorRowChanged(E, row, at, -1);
+	editorRowMark(E, row->idx);
+}
+
+void editorRowTruncate(struct editorConfig *E, erow *row, size_t at) {
+	if (at >= row->size) return;
+	editorRowTouch(E, row);
+	countsAdd(&E->offsets, row->idx, -(ssize_t)(row->size - at));
+	row->size = at;
+	row->chars[row->size] = '\0';
+	editorRowRefresh(E, row, ROW_STALE_RENDER | ROW_STALE_SYNTAX);
+	editorRowMark(E, row->idx);
+}
@@ -4,31 +4,102 @@
 #include "structs.h"
 
 // convert chars index to render index to render tabs
-int editorRowCxToRx(erow *row, int cx);
+size_t editorRowCxToRx(erow *row, size_t cx);
 
 // convert render index to char index to process rows with tabs
-int editorRowRxToCx(erow *row, int rx);
+size_t editorRowRxToCx(erow *row, size_t rx);
+
+// (both of the above count columns: a tab goes to the next tab stop, a
+// code point takes utf8Width columns, see utf8.h. The row mustn't be cold)
+
+// the index in render of the byte chars[cx] became
+size_t editorRowCxToRender(erow *row, size_t cx);
+
+// the cx of the byte at render[at]
+size_t editorRowRenderToCx(erow *row, size_t at);
+
+// where the cursor goes from cx moving left or right by a code point
+// (and the combining marks after it)
+size_t editorRowPrevCx(struct editorConfig *E, erow *row, size_t cx);
+size_t editorRowNextCx(struct editorConfig *E, erow *row, size_t cx);
+
+// cx moved back to the start of the code point it's in (or of the one
+// its combining mark goes with)
+size_t editorRowSnapCx(struct editorConfig *E, erow *row, size_t cx);
+
+// byte offset of the start of row at in the saved file (numrows gives
+// the file size), O(log n)
+size_t editorRowOffset(struct editorConfig *E, size_t at);
+
+// the row holding a byte offset, numrows if it's past the end, O(log n)
+size_t editorRowAtOffset(struct editorConfig *E, size_t offset);
 
 // use chars string of erow to fill in render string
-void editorUpdateRow(erow *row);
+void editorUpdateRow(struct editorConfig *E, erow *row);
+
+// group row changes into one edit: inside it rows changed, inserted or
+// deleted are only marked stale, and editorCommitEdit renders and lexes
+// each of them once, top down, so typing or pasting many lines costs
+// one highlighting pass however many rows and changes it makes. Edits
+// nest, the outermost commit does the work. Nothing that reads render
+// or hl (drawing, searching) may run inside an edit
+void editorBeginEdit(struct editorConfig *E);
+void editorCommitEdit(struct editorConfig *E);
+
+// render a row whose chars were just restored (see cold.h) and lex it
+// from the row above, leaving the rows below alone
+void editorRowRestore(struct editorConfig *E, erow *row);
+
+// render text and highlight of columns [rx, rx + len) of a row, which
+// has to be at least rx columns wide (thawing it if it's cold)
+char *editorRowRender(struct editorConfig *E, erow *row, size_t rx, size_t len,
+	unsigned char **hl);
 
 // insert a row at specified index
-void editorInsertRow(int at, char *s, size_t len);
+void editorInsertRow(struct editorConfig *E, size_t at, char *s, size_t len);
+
+// append a row while loading a file: rendered but not highlighted
+// (follow up with editorHighlightRows) and not counted as a change
+void editorLoadRow(struct editorConfig *E, char *s, size_t len);
+
+// append count rows while loading a file, with nothing in them but
+// their sizes: bytes[j] is row j's size plus its newline. Their chars,
+// exit states and bracket summaries are left to the caller, which has to
+// make each row cold (see editorColdLoad) or give it chars and restore
+// it (editorRowRestore) before anything else looks at it
+void editorLoadRowsBare(struct editorConfig *E, const size_t *bytes, size_t count);
+
+// replace the del rows from at with count new ones (highlighted, and
+// marked as changed)
+void editorReplaceRows(struct editorConfig *E, size_t at, size_t del, char **lines,
+	size_t *lens, size_t count);
+
+// replace the chars of a row with len bytes (null terminated, taken
+// over) and render it, leaving the rest to editorRowsSwapped. Touches
+// nothing but the row, so rows can be rewritten on any thread
+void editorRowSwapChars(erow *row, char *chars, size_t len);
+
+// finish the n rows (ascending) rewritten with editorRowSwapChars: their
+// offsets, marks for the next save and highlighting
+void editorRowsSwapped(struct editorConfig *E, const size_t *rows, size_t n);
 
 // free the memory owned by a row (when deleting for ex.)
 void editorFreeRow(erow *row);
 
 // delete row (with memmove)
-void editorDelRow(int at);
+void editorDelRow(struct editorConfig *E, size_t at);
 
 // insert a char into a row at a specific position
-void editorRowInsertChar(erow *row, int at, int c);
+void editorRowInsertChar(struct editorConfig *E, erow *row, size_t at, int c);
 
 // append row to end of string (i.e. when pressing delete on the first
 // character in a row)
-void editorRowAppendString(erow *row, char *s, size_t len);
+void editorRowAppendString(struct editorConfig *E, erow *row, char *s, size_t len);
+
+// cut a row short at a specified index (i.e. when splitting a line)
+void editorRowTruncate(struct editorConfig *E, erow *row, size_t at);
 
 // delete a character in an erow at a specified index
-void editorRowDelChar(erow *row, int at);
+void editorRowDelChar(struct editorConfig *E, erow *row, size_t at);
 
-#endif
\ No newline at end of file
+#endif
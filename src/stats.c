@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <time.h>
+#include "stats.h"
+
+static const char *stat_names[STAT_COUNT] = {
+	"read_key", "process_key", "update_syntax", "draw_rows", "write", "key_to_paint"
+};
+
+uint64_t statsNow() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// values below 2^STATS_SUB_BITS get a bucket each, above that every power
+// of two is split into 2^STATS_SUB_BITS equal buckets
+static size_t statsBucket(uint64_t v) {
+	if (v < (1 << STATS_SUB_BITS)) return v;
+	int exp = 63 - __builtin_clzll(v);
+	if (exp >= STATS_MAX_EXP) return STATS_BUCKETS - 1;
+	size_t sub = (v >> (exp - STATS_SUB_BITS)) & ((1 << STATS_SUB_BITS) - 1);
+	return ((size_t)(exp - STATS_SUB_BITS + 1) << STATS_SUB_BITS) + sub;
+}
+
+// smallest value that falls into a bucket
+static uint64_t statsBucketValue(size_t b) {
+	if (b < (1 << STATS_SUB_BITS)) return b;
+	int exp = (b >> STATS_SUB_BITS) + STATS_SUB_BITS - 1;
+	uint64_t sub = b & ((1 << STATS_SUB_BITS) - 1);
+	return ((1ULL << STATS_SUB_BITS) + sub) << (exp - STATS_SUB_BITS);
+}
+
+void statsRecord(struct editorHistogram *h, uint64_t ns) {
+	h->counts[statsBucket(ns)]++;
+	if (h->total == 0 || ns < h->min) h->min = ns;
+	if (ns > h->max) h->max = ns;
+	h->total++;
+}
+
+void statsPhase(struct editorStats *stats, enum EDITOR_STAT phase, uint64_t start) {
+	if (stats == NULL) return;
+	statsRecord(&stats->hist[phase], statsNow() - start);
+}
+
+uint64_t statsPercentile(struct editorHistogram *h, double q) {
+	if (h->total == 0) return 0;
+	uint64_t rank = (uint64_t)(q * h->total);
+	if (rank >= h->total) rank = h->total - 1;
+	uint64_t seen = 0;
+	for (size_t b = 0; b < STATS_BUCKETS; b++) {
+		seen += h->counts[b];
+		if (seen > rank) {
+			uint64_t v = statsBucketValue(b);
+			// the bucket's lower bound can undershoot the recorded extremes
+			if (v < h->min) v = h->min;
+			if (v > h->max) v = h->max;
+			return v;
+		}
+	}
+	return h->max;
+}
+
+void statsFormatNs(char *buf, size_t len, uint64_t ns) {
+	if (ns < 1000) snprintf(buf, len, "%uns", (unsigned)ns);
+	else if (ns < 1000000) snprintf(buf, len, "%.1fus", ns / 1e3);
+	else if (ns < 1000000000) snprintf(buf, len, "%.1fms", ns / 1e6);
+	else snprintf(buf, len, "%.2fs", ns / 1e9);
+}
+
+void statsDump(struct editorStats *stats, FILE *fp) {
+	for (int i = 0; i < STAT_COUNT; i++) {
+		struct editorHistogram *h = &stats->hist[i];
+		fprintf(fp, "%s: count=%llu min=%llu p50=%llu p90=%llu p99=%llu p999=%llu max=%llu\n",
+			stat_names[i], (unsigned long long)h->total,
+			(unsigned long long)h->min,
+			(unsigned long long)statsPercentile(h, 0.5),
+			(unsigned long long)statsPercentile(h, 0.9),
+			(unsigned long long)statsPercentile(h, 0.99),
+			(unsigned long long)statsPercentile(h, 0.999),
+			(unsigned long long)h->max);
+		for (size_t b = 0; b < STATS_BUCKETS; b++) {
+			if (h->counts[b] == 0) continue;
+			fprintf(fp, "  %llu %llu\n", (unsigned long long)statsBucketValue(b),
+				(unsigned long long)h->counts[b]);
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "structs.h"
+
+// current value of the monotonic clock in nanoseconds
+uint64_t statsNow();
+
+// add a duration (in nanoseconds) to a histogram
+void statsRecord(struct editorHistogram *h, uint64_t ns);
+
+// record the time elapsed since start for a phase, if timings are collected
+void statsPhase(struct editorStats *stats, enum EDITOR_STAT phase, uint64_t start);
+
+// value below which the fraction q (0..1) of the recorded durations fall
+uint64_t statsPercentile(struct editorHistogram *h, double q);
+
+// format a duration for humans ("850ns", "12.3us", "4.5ms", "1.20s")
+void statsFormatNs(char *buf, size_t len, uint64_t ns);
+
+// write a summary and the non-empty buckets of every histogram
+void statsDump(struct editorStats *stats, FILE *fp);
+
+#endif
@@ -1,8 +1,12 @@
 #ifndef __STRUCTS_H__
 #define __STRUCTS_H__
 
-#include <termios.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 #include <time.h>
+#include "constants.h"
+#include "enums.h"
 
 struct editorSyntax {
 	char *filetype;
@@ -12,35 +16,294 @@ struct editorSyntax {
 	char *multiline_comment_start;
 	char *multiline_comment_end;
 	int flags;
+	struct editorLexer *lexer; // compiled form of the above, see lexer.h
+};
+
+// where the lexer stands between two bytes of a row, enough to resume
+// lexing from there (see lexerResume)
+struct lexerState {
+	int in_comment; // inside a multi-line comment
+	int in_string; // quote byte of the open string, 0 if none
+	int line_comment; // a single-line comment runs to the end of the row
+	int prev_sep; // the previous byte was a separator
+	int prev_number; // the previous byte was part of a number
+	size_t skip; // bytes already claimed by a match that started earlier
+	unsigned char skip_hl; // and their highlight
+};
+
+// a slice of a long row's chars
+struct erowChunk {
+	size_t start; // offset of the first byte in chars
+	size_t len;
+	size_t rx; // render column of the first byte
+	size_t lead; // bytes before the first tab (len if there is none)
+	size_t tail; // columns after the first tab, counted from a tab stop
+	struct lexerState entry; // lexer state before the first byte
+};
+
+// chunked form of a long row: chars stay contiguous, but render and hl
+// only hold the chunks [wfirst, wlast] that were last drawn
+struct erowChunks {
+	struct erowChunk *c;
+	size_t n;
+	size_t dirty_from, dirty_to; // chunks to re-lex, none if from > to
+	struct lexerState exit; // lexer state at the end of the row
+	struct editorSyntax *syntax; // syntax the entry states were lexed with
+	int wvalid; // render and hl hold a window
+	size_t wfirst, wlast;
+};
+
+// brackets of a row or a run of rows outside strings and comments, see
+// brackets.h: opening minus closing ones, the lowest the running count
+// gets from 0 (<= 0) and the most any tail of them opens (>= 0)
+struct bracketSummary {
+	int delta;
+	int min;
+	int max;
 };
 
 typedef struct erow {
-	int idx;
-	int size;
-	int rsize;
+	size_t idx;
+	size_t size;
+	size_t rsize;
 	char *chars;
 	char *render;
 	unsigned char *hl;
 	int hl_open_comment;
+	unsigned char ascii; // chars are all ASCII (or it's a long row), a byte is a column
+	unsigned char stale; // ROW_STALE_* updates left for editorCommitEdit
+	uint16_t wrap_gen; // its count in the wrap layout is fresh if this is the layout's gen
+	struct bracketSummary brackets; // as of its last highlighting
+	struct erowChunks *chunks; // set for long rows, see longrow.h
+	struct coldBlock *cold; // set for cold rows (chars, render and hl NULL), see cold.h
+	struct internLine *shared; // set for interned rows (chars, render and hl are its), see intern.h
+	size_t cold_at; // where the row's chars start in the block's text
 } erow;
 
+// node of a counted B-tree, see counts.h
+struct countNode {
+	size_t n; // children (inner node) or counts (leaf) held
+	size_t rows; // counts under the node
+	size_t sum; // their sum
+	int leaf;
+	union {
+		struct countNode *child[EDITOR_COUNTS_FANOUT];
+		size_t count[EDITOR_COUNTS_FANOUT];
+	} u;
+};
+
+// sequence of counts, see counts.h
+struct countTree {
+	struct countNode *root; // NULL while empty
+};
+
+// what changed since the file was last read or written, so editorSave
+// can write just that (see fileio.h)
+struct editorSaveState {
+	int exact; // the file held exactly the bytes the rows are saved as
+	dev_t dev; // and this is what it looked like then
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+	size_t first, last; // rows changed since (last may be numrows), none if first > last
+};
+
+// rows with updates left for the end of an edit, see editorBeginEdit
+struct editorEdit {
+	int depth; // editorBeginEdit calls not committed yet
+	size_t first, last; // stale rows are among these, none if first > last
+};
+
+// inotify watch on the open file, see watch.h
+struct editorWatch {
+	int fd; // -1 if not watching
+	char *name; // the file's name in its directory
+};
+
+// follow mode state, see follow.h
+struct editorFollow;
+
+// the chars of a run of cold rows, each followed by a null byte,
+// compressed (see cold.h)
+struct coldBlock {
+	unsigned char *data;
+	size_t len; // compressed bytes
+	size_t raw; // bytes of text
+	size_t rows; // rows still in the block
+	char *text; // decompressed, NULL unless the block is in the cache
+	struct coldBlock *prev, *next; // cache order, most recently used first
+};
+
+// cold row state, see cold.h
+struct editorCold {
+	struct coldBlock *first, *last; // blocks with text, most recently used first
+	size_t cached;
+	size_t sweep; // the next row the sweep looks at
+	size_t left; // rows the sweep has yet to look at, 0 when it's done
+};
+
+// rows [at, at + add) of the buffer in place of del lines of the file
+// on disk, see diff.h
+struct diffHunk {
+	size_t at, add, del;
+};
+
+// diff gutter, see diff.h
+struct editorDiff {
+	int on;
+	uint32_t *hash; // per row, 0 until it's hashed
+	size_t n, cap;
+	size_t lo, hi; // rows that may not be hashed, none if lo >= hi
+	size_t gen; // bumped by every change to the rows
+	size_t base_gen; // bumped when the file is synced with the rows
+	uint32_t *base; // per line of the file on disk
+	size_t nbase;
+	size_t base_done; // base_gen the base was read for
+	struct diffHunk *hunks; // sorted by row
+	size_t nhunks;
+	size_t done; // gen the hunks are for
+	struct diffJob *job; // the diff running in the background, NULL if none
+	int wake[2]; // it writes a byte to wake[1] once it's done
+};
+
+// a row's highlighting, cached by its render and entry state
+struct hlCacheSlot {
+	unsigned char *data; // render, then hl (cap bytes each)
+	size_t len, cap;
+	uint32_t hash;
+	int entry, exit; // lexer state before and after it
+	struct editorSyntax *syntax;
+	unsigned int uses; // hits not yet spent keeping it from being replaced
+};
+
+// highlight cache, see hlcache.h
+struct editorHlCache {
+	struct hlCacheSlot *slots; // NULL until the first row goes in
+	size_t lookups, hits; // updated atomically, for tuning
+};
+
+// a line shared by the rows holding it, see intern.h
+struct internLine {
+	char *chars;
+	char *render;
+	unsigned char *hl;
+	size_t size, rsize;
+	uint32_t hash;
+	int entry, exit; // lexer state before and after it
+	struct editorSyntax *syntax; // hl was lexed with
+	struct editorIntern *owner;
+	size_t refs; // rows sharing it (updated atomically), 0 once it's gone
+};
+
+// line intern table, see intern.h
+struct editorIntern {
+	int on;
+	struct internLine **lines;
+	size_t nlines, cap;
+	uint32_t *table; // hash table of line index + 1, 0 for a free slot
+	size_t mask; // table size - 1
+	size_t sweep; // the next row the sweep looks at
+	size_t left; // rows the sweep has yet to share, 0 when it's done
+	size_t back; // rows it then has yet to give back the lines only they have
+	size_t unshared; // rows that stopped sharing a line (updated atomically)
+	size_t seen; // unshared as of the sweep's last look
+};
+
+// a word in the identifier index
+struct wordEntry {
+	uint32_t at; // where it starts in the index's text
+	uint32_t len;
+	uint32_t hash;
+	uint32_t count; // occurrences in the indexed rows, 0 once it's gone
+};
+
+// identifier index, see words.h
+struct editorWords {
+	char *text; // the words, back to back
+	size_t len, cap;
+	struct wordEntry *entries;
+	size_t nentries, capentries;
+	uint32_t *table; // hash table of entry index + 1, 0 for a free slot
+	size_t mask; // table size - 1
+	uint32_t *sorted; // entries [0, nsorted) in word order, later ones are new
+	size_t nsorted;
+	size_t dead; // entries with count 0
+	size_t upto; // rows [0, upto) are indexed
+};
+
+// segment tree of the rows' bracket summaries, see brackets.h
+struct editorBrackets {
+	struct bracketSummary *t; // node i has children 2i and 2i + 1, row j's leaf is cap + j
+	size_t cap; // leaves, a power of two
+	size_t n; // leaves in use, one per row
+	size_t top; // most leaves in use since the nodes were last brought up to date
+	size_t valid; // nodes above leaves [0, valid) (and no others) are up to date
+};
+
+// soft wrap layout, see wrap.h
+struct editorWrap {
+	int on;
+	int cols; // screen width the layout is for
+	uint16_t gen; // bumped whenever every count may be stale, never 0
+	struct countTree lines; // visual lines per row, as of when it was last wrapped
+	size_t lineoff; // visual lines of row rowoff scrolled off the top
+	size_t y, x; // the cursor on screen, see editorWrapScroll
+};
+
+// incremental search state kept between calls of editorFindCallback
+struct editorFindState {
+	ssize_t last_match;
+	int direction;
+	size_t saved_hl_line;
+	char *saved_hl; // highlight of the matched row before it was marked
+};
+
+// fixed-size log-linear (HDR style) histogram of durations in nanoseconds
+struct editorHistogram {
+	uint64_t counts[STATS_BUCKETS];
+	uint64_t total;
+	uint64_t min, max;
+};
+
+// per-phase timings of the main loop, see enum EDITOR_STAT
+struct editorStats {
+	struct editorHistogram hist[STAT_COUNT];
+	int overlay; // show latency percentiles in the status bar
+	int key_pending; // a key was read and hasn't been painted yet
+	int key; // the last key read
+	uint64_t key_time; // when that key was read
+};
+
+// an editor context: one buffer plus its view. Every core function takes
+// one of these explicitly, so a process can hold as many as it likes
 struct editorConfig {
-	int cx, cy;
-	int rx; // index for render to handle tabs
-	int rowoff;
-	int coloff;
+	size_t cx, cy;
+	size_t rx; // index for render to handle tabs
+	size_t rowoff;
+	size_t coloff;
 	int screenrows;
 	int screencols;
-	int numrows;
+	size_t numrows;
 	erow *row;
-	int dirty;
+	struct countTree offsets; // bytes per row (newline included), see editorRowOffset
+	struct editorSaveState save;
+	struct editorEdit edit;
+	struct editorWatch watch;
+	struct editorFollow *follow; // NULL unless following a file or pipe
+	struct editorCold cold;
+	struct editorWords words;
+	struct editorBrackets brackets;
+	struct editorWrap wrap;
+	struct editorIntern intern;
+	struct editorHlCache hlcache;
+	struct editorDiff diff;
+	size_t dirty;
 	char *filename;
 	char statusmsg[80];
 	time_t statusmsg_time;
 	struct editorSyntax *syntax;
-	struct termios orig_termios;
+	struct editorFindState find;
+	struct editorStats *stats; // NULL unless the front end collects timings
 };
 
-extern struct editorConfig E;
-
-#endif
\ No newline at end of file
+#endif
@@ -1,29 +1,57 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <termios.h>
 #include <errno.h>
 #include <unistd.h>
+#include <poll.h>
+#include <signal.h>
 #include <sys/ioctl.h>
-#include "structs.h"
+#include "constants.h"
+#include "main.h"
 #include "enums.h"
+#include "output.h"
+#include "stats.h"
+#include "terminal.h"
+#include "vterm.h"
+#include "record.h"
+#include "watch.h"
+#include "follow.h"
+#include "cold.h"
+#include "intern.h"
+#include "words.h"
+#include "diff.h"
+
+// terminal attributes to restore on exit
+static struct termios orig_termios;
+
+// the window changed size since the last frame (SIGWINCH)
+static volatile sig_atomic_t resized;
+
+static void editorOnResize(int sig) {
+	(void)sig;
+	resized = 1;
+}
 
 void die(const char *s) {
-	write(STDOUT_FILENO, "\x1b[2J", 4);
-	write(STDOUT_FILENO, "\x1b[H", 3);
+	editorWrite("\x1b[2J", 4);
+	editorWrite("\x1b[H", 3);
 	perror(s);
 	exit(1);
 }
 
 void disableRawMode() {
-	if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &E.orig_termios) == -1)
+	if (vtermActive()) return;
+	if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios) == -1)
 		die("tcsetattr");
 }
 
 void enableRawMode() {
-	if (tcgetattr(STDIN_FILENO, &E.orig_termios) == -1)
+	if (vtermActive()) return;
+	if (tcgetattr(STDIN_FILENO, &orig_termios) == -1)
 		die("tcgetattr");
 	atexit(disableRawMode);
-	struct termios raw = E.orig_termios;
+	struct termios raw = orig_termios;
 	raw.c_iflag &= ~(BRKINT | ICRNL | IXON | INPCK | ISTRIP);
 	raw.c_oflag &= ~(OPOST);
 	raw.c_cflag |= (CS8);
@@ -32,13 +60,23 @@ void enableRawMode() {
 	raw.c_cc[VTIME] = 1;
 	if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1)
 		die("tcgetattr");
+
+	// not restarted, so a wait for a key ends and the screen is redrawn
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = editorOnResize;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGWINCH, &sa, NULL);
 }
 
-int editorReadKey() {
+// read a key from the tty, decoding escape sequences
+static int editorDecodeKey() {
 	int nread;
 	char c;
 	while ((nread = read(STDIN_FILENO, &c, 1)) != 1) {
-		if (nread == -1 && errno != EAGAIN) die("read");
+		// a resize reads as the refresh key
+		if (resized) return CTRL_KEY('l');
+		if (nread == -1 && errno != EAGAIN && errno != EINTR) die("read");
 	}
 
 	if (c == '\x1b') {
@@ -82,6 +120,95 @@ int editorReadKey() {
 	}
 }
 
+int editorReadKey() {
+	int c;
+	if (vtermActive()) {
+		c = vtermReadKey();
+	} else {
+		c = editorDecodeKey();
+		recordKey(c);
+	}
+	if (E.stats) {
+		E.stats->key = c;
+		E.stats->key_time = statsNow();
+		E.stats->key_pending = 1;
+	}
+	return c;
+}
+
+void editorWaitKey() {
+	if (vtermActive()) return;
+	while (editorWatchFd(&E) != -1 || editorFollowFd(&E) != -1 || editorDiffFd(&E) != -1 ||
+			editorInternPending(&E) || editorColdPending(&E) || editorWordsPending(&E)) {
+		struct pollfd fds[4] = {
+			{ .fd = STDIN_FILENO, .events = POLLIN },
+			{ .fd = editorWatchFd(&E), .events = POLLIN },
+			{ .fd = editorFollowFd(&E), .events = POLLIN },
+			{ .fd = editorDiffFd(&E), .events = POLLIN },
+		};
+		// lines left over from the last frame go out right away, and
+		// rows are hashed for the diff, shared, frozen and indexed while
+		// there's nothing else to do
+		int pending = editorFollowPending(&E);
+		int sweep = editorDiffPending(&E) || editorInternPending(&E) || editorColdPending(&E) ||
+			editorWordsPending(&E);
+		if (poll(fds, 4, pending || sweep ? 0 : -1) == -1) {
+			if (errno == EINTR && resized) return;
+			if (errno == EINTR) continue;
+			die("poll");
+		}
+		if (fds[0].revents) return;
+		int repaint = 0;
+		if (fds[1].revents) repaint |= editorWatchService(&E);
+		if (fds[2].revents || pending) repaint |= editorFollowService(&E);
+		if (fds[3].revents) repaint |= editorDiffService(&E);
+		// at most one frame per batch of work
+		if (repaint) editorRefreshScreen();
+		else if (editorDiffPending(&E)) editorDiffSweep(&E);
+		else if (editorInternPending(&E)) editorInternSweep(&E);
+		else if (editorColdPending(&E)) editorColdSweep(&E);
+		else if (sweep) editorWordsSweep(&E);
+	}
+}
+
+void editorWrite(const char *s, size_t len) {
+	if (vtermActive()) {
+		vtermWrite(s, len);
+		return;
+	}
+	while (len > 0) {
+		ssize_t n = write(STDOUT_FILENO, s, len);
+		if (n == -1) {
+			if (errno == EINTR) continue;
+			return;
+		}
+		s += n;
+		len -= n;
+	}
+}
+
+void editorRefreshScreen() {
+	int rows, cols;
+	if (resized && getWindowSize(&rows, &cols) == 0) {
+		// soft wrap re-wraps rows as they're drawn at the new width
+		E.screenrows = rows - 2;
+		E.screencols = cols;
+	}
+	resized = 0;
+	struct abuf ab = ABUF_INIT;
+	editorDrawScreen(&E, &ab);
+	uint64_t start = E.stats ? statsNow() : 0;
+	editorWrite(ab.b, ab.len);
+	statsPhase(E.stats, STAT_WRITE, start);
+	if (E.stats && E.stats->key_pending) {
+		uint64_t latency = statsNow() - E.stats->key_time;
+		statsRecord(&E.stats->hist[STAT_KEY_TO_PAINT], latency);
+		replayKeyPainted(E.stats->key, latency);
+		E.stats->key_pending = 0;
+	}
+	abFree(&ab);
+}
+
 int getCursorPosition(int *rows, int *cols) {
 	char buf[32];
 	unsigned int i = 0;
@@ -106,6 +233,10 @@ int getWindowSize(int *rows, int *cols) {
 	// you can now use the return value for the code
 	struct winsize ws;
 
+	if (vtermActive()) {
+		vtermGetWindowSize(rows, cols);
+		return 0;
+	}
 	if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) {
 		// move cursor to bottom right of screen (using large values ie 999)
 		if (write(STDOUT_FILENO, "\x1b[999C\x1b[999B", 12) != 12) return -1;
@@ -1,6 +1,8 @@
 #ifndef __TERMINAL_H__
 #define __TERMINAL_H__
 
+#include <stddef.h>
+
 // kill the program / clear the screen on exit
 void die(const char *s);
 
@@ -13,6 +15,17 @@ void enableRawMode();
 // read and return the next key stroke
 int editorReadKey();
 
+// block until a key stroke is ready, servicing changes to the open file
+// and followed input in the meantime (see watch.h and follow.h) and
+// freezing cold rows when there is nothing else to do (see cold.h)
+void editorWaitKey();
+
+// write a buffer out to the terminal
+void editorWrite(const char *s, size_t len);
+
+// draw the front end's editor and write the frame to the terminal
+void editorRefreshScreen();
+
 // get and return the current cursor position
 int getCursorPosition(int *rows, int *cols);
 
@@ -0,0 +1,379 @@
+/*** feature test macros for code portability ***/
+#define _DEFAULT_SOURCE
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#include "structs.h"
+#include "editor.h"
+#include "row.h"
+#include "fileio.h"
+#include "find.h"
+
+// large file round trips: builds files past the 32-bit limits (a sparse
+// one over 4 GB and one with a single line over 2 GB), then opens each,
+// finds a marker past the limit, edits it, saves, and reads the file back
+// byte for byte. A case the machine hasn't the memory or disk for is
+// skipped. --small runs the same checks on files 4096 times smaller
+//
+// Then the save journal: saves cut short at each point are rolled
+// forward, a journal for a file changed since is refused, and a save
+// that can't write one fails
+//
+//   usage: editor-test [--small]
+
+#define TEST_SPARSE_SIZE (((off_t)1 << 32) + (1 << 20))
+#define TEST_LONG_SIZE (((off_t)1 << 31) + (1 << 20))
+#define TEST_SMALL_SHIFT 12
+
+#define TEST_MARKER "wasm_test_marker"
+#define TEST_PATTERN "0123456789"
+
+// bytes per write and per compare
+#define TEST_CHUNK (1 << 20)
+
+// copies of its file a case needs in memory: the longest line is held in
+// the buffer it's read into and in the row's chars (a long row has no
+// full render or hl), and the save only writes what changed
+#define TEST_COPIES 2
+
+// memory a case needs besides those copies
+#define TEST_SLACK ((off_t)256 << 20)
+
+// a file is head, then body bytes that are either a hole (NULs, no
+// newlines, so one long line) or TEST_PATTERN over and over, then tail
+struct testFile {
+	const char *name;
+	char path[80];
+	const char *head;
+	int hole;
+	char tail[64];
+	off_t size;
+	off_t marker; // where TEST_MARKER is
+	size_t marker_row;
+	size_t rows;
+};
+
+static struct editorConfig E;
+static int failures;
+
+/*** helpers ***/
+
+static void testFail(const char *name, const char *what) {
+	printf("FAIL %s: %s\n", name, what);
+	failures++;
+}
+
+// the bytes [off, off + len) the file should hold
+static void testExpect(struct testFile *t, off_t off, char *buf, size_t len) {
+	off_t headlen = strlen(t->head), taillen = strlen(t->tail);
+	size_t patlen = strlen(TEST_PATTERN);
+	for (size_t i = 0; i < len; i++, off++) {
+		if (off < headlen) buf[i] = t->head[off];
+		else if (off >= t->size - taillen) buf[i] = t->tail[off - (t->size - taillen)];
+		else if (t->hole) buf[i] = '\0';
+		else buf[i] = TEST_PATTERN[(off - headlen) % patlen];
+	}
+}
+
+static int testWrite(struct testFile *t) {
+	int fd = open(t->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1) return -1;
+	char *buf = malloc(TEST_CHUNK);
+	off_t headlen = strlen(t->head), taillen = strlen(t->tail);
+	int ret = 0;
+	for (off_t off = 0; off < t->size && ret == 0; ) {
+		// a hole is left unwritten, which is what makes the file sparse
+		if (t->hole && off == headlen) off = t->size - taillen;
+		size_t len = t->size - off < TEST_CHUNK ? t->size - off : TEST_CHUNK;
+		if (t->hole && off < headlen && off + (off_t)len > headlen) len = headlen - off;
+		testExpect(t, off, buf, len);
+		if (pwrite(fd, buf, len, off) != (ssize_t)len) ret = -1;
+		off += len;
+	}
+	free(buf);
+	if (close(fd) == -1) ret = -1;
+	return ret;
+}
+
+// whether the file on disk holds exactly what testExpect says
+static int testCompare(struct testFile *t) {
+	int fd = open(t->path, O_RDONLY);
+	if (fd == -1) return 0;
+	char *got = malloc(TEST_CHUNK), *want = malloc(TEST_CHUNK);
+	struct stat st;
+	int same = fstat(fd, &st) == 0 && st.st_size == t->size;
+	for (off_t off = 0; same && off < t->size; ) {
+		ssize_t n = read(fd, got, TEST_CHUNK);
+		if (n <= 0) {
+			same = 0;
+			break;
+		}
+		testExpect(t, off, want, n);
+		same = memcmp(got, want, n) == 0;
+		off += n;
+	}
+	free(got);
+	free(want);
+	close(fd);
+	return same;
+}
+
+// kB of memory available, or -1 if that can't be told
+static long testMemAvailable() {
+	FILE *fp = fopen("/proc/meminfo", "r");
+	if (!fp) return -1;
+	char line[128];
+	long kb = -1;
+	while (fgets(line, sizeof(line), fp))
+		if (sscanf(line, "MemAvailable: %ld kB", &kb) == 1) break;
+	fclose(fp);
+	return kb;
+}
+
+// whether the machine has the memory and disk for the case
+static int testFits(struct testFile *t) {
+	long kb = testMemAvailable();
+	off_t mem = t->size * TEST_COPIES + TEST_SLACK;
+	if (kb != -1 && (off_t)kb * 1024 < mem) {
+		printf("skip %s: needs about %lld MB of memory, %ld MB available\n", t->name,
+			(long long)(mem >> 20), kb >> 10);
+		return 0;
+	}
+	struct statvfs vfs;
+	off_t disk = t->hole ? (off_t)TEST_CHUNK : t->size;
+	if (statvfs("/tmp", &vfs) == 0 && (off_t)vfs.f_bavail * (off_t)vfs.f_frsize < disk * 2) {
+		printf("skip %s: needs about %lld MB of disk in /tmp\n", t->name,
+			(long long)(disk * 2 >> 20));
+		return 0;
+	}
+	return 1;
+}
+
+/*** the round trip ***/
+
+static void testRoundTrip(struct testFile *t) {
+	if (!testFits(t)) return;
+	if (testWrite(t) == -1) {
+		testFail(t->name, "can't write the file");
+		unlink(t->path);
+		return;
+	}
+
+	editorInit(&E, 24, 80);
+	int before = failures;
+	if (editorOpen(&E, t->path) != 0) {
+		testFail(t->name, "editorOpen");
+		goto done;
+	}
+	if (E.numrows != t->rows) testFail(t->name, "open: wrong number of rows");
+	if (editorRowOffset(&E, E.numrows) != (size_t)t->size) testFail(t->name, "open: rows don't add up to the file");
+	if (!E.save.exact) testFail(t->name, "open: file not taken as exact");
+
+	// a marker past the limit
+	editorFindCallback(&E, TEST_MARKER, 'a');
+	if (E.cy != t->marker_row || editorRowOffset(&E, E.cy) + E.cx != (size_t)t->marker)
+		testFail(t->name, "find: marker not found where it is");
+	editorFindCallback(&E, TEST_MARKER, '\r');
+
+	// change the first letter of the last row, keeping the size, so the
+	// save writes just that row, past the limit
+	erow *row = &E.row[E.numrows - 1];
+	editorRowDelChar(&E, row, 0);
+	editorRowInsertChar(&E, row, 0, 'I');
+	t->tail[strlen(t->tail) - row->size - 1] = 'I';
+	if (!E.dirty) testFail(t->name, "edit: not marked modified");
+
+	if (editorSave(&E) != 0) testFail(t->name, "editorSave");
+	else if (E.dirty) testFail(t->name, "save: still marked modified");
+	if (!testCompare(t)) testFail(t->name, "re-read: file differs from what was saved");
+
+done:
+	editorFree(&E);
+	unlink(t->path);
+	if (failures == before)
+		printf("ok   %s: %lld bytes, open, find, edit, save, re-read\n", t->name, (long long)t->size);
+}
+
+/*** the save journal ***/
+
+#define TEST_JOURNAL_SIZE (3 * 4096 + 1000)
+
+// where the save was cut short, after its journal was written
+enum testCut {
+	TEST_CUT_BEFORE, // before the file was touched
+	TEST_CUT_BLOCKS, // after the first two blocks of it were written
+	TEST_CUT_UNLINK, // with only the journal left to remove
+	TEST_CUT_CHANGED, // and then the file was changed some other way
+	TEST_CUT_REPLACED, // and then the file was replaced by a copy
+};
+
+static int testJournalFile(const char *path, const char *buf, size_t len) {
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd != -1 && pwrite(fd, buf, len, 0) != (ssize_t)len) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+// a save of len bytes at offset that truncates to size, cut short
+static void testJournal(const char *name, enum testCut cut, off_t offset, size_t len, off_t size) {
+	char path[80], journal[96];
+	snprintf(path, sizeof(path), "/tmp/wasm-editor-test-%d-journal.txt", (int)getpid());
+	snprintf(journal, sizeof(journal), "%s.journal", path);
+
+	size_t old_size = TEST_JOURNAL_SIZE;
+	size_t max = old_size > offset + len ? old_size : offset + len;
+	char *old = malloc(old_size), *data = malloc(len), *want = calloc(max, 1);
+	char *got = malloc(max + 1);
+	for (size_t i = 0; i < old_size; i++) old[i] = 'a' + i % 26;
+	for (size_t i = 0; i < len; i++) data[i] = 'A' + i % 26;
+	// what the file holds once the save is done, or as it's left
+	memcpy(want, old, old_size);
+	memcpy(want + offset, data, len);
+	size_t want_size = size;
+	int want_ret = 1;
+
+	int before = failures;
+	int fd = testJournalFile(path, old, old_size);
+	if (fd == -1 || editorJournalWrite(path, fd, data, len, offset, size) == -1) {
+		testFail(name, "can't write the file and its journal");
+		if (fd != -1) close(fd);
+		goto done;
+	}
+	size_t blocks = 2 * 4096 - offset % 4096;
+	switch (cut) {
+	case TEST_CUT_BEFORE:
+		break;
+	case TEST_CUT_BLOCKS:
+		if (pwrite(fd, data, blocks, offset) != (ssize_t)blocks) testFail(name, "pwrite");
+		break;
+	case TEST_CUT_UNLINK:
+		if (pwrite(fd, data, len, offset) != (ssize_t)len || ftruncate(fd, size) == -1)
+			testFail(name, "pwrite");
+		break;
+	case TEST_CUT_CHANGED:
+		old[offset + len / 2] = '!';
+		if (pwrite(fd, "!", 1, offset + len / 2) != 1) testFail(name, "pwrite");
+		/* fall through */
+	case TEST_CUT_REPLACED:
+		memcpy(want, old, old_size);
+		want_size = old_size;
+		want_ret = 2;
+		break;
+	}
+	close(fd);
+	if (cut == TEST_CUT_REPLACED) {
+		// the way most editors save: a copy renamed over it
+		char copy[96];
+		snprintf(copy, sizeof(copy), "%s.copy", path);
+		fd = testJournalFile(copy, old, old_size);
+		if (fd == -1 || rename(copy, path) == -1) testFail(name, "can't replace the file");
+		if (fd != -1) close(fd);
+	}
+
+	if (editorRecover(path) != want_ret) testFail(name, "editorRecover returned the wrong thing");
+	if (access(journal, F_OK) != (want_ret == 2 ? 0 : -1))
+		testFail(name, want_ret == 2 ? "journal not kept" : "journal not removed");
+	fd = open(path, O_RDONLY);
+	ssize_t n = fd == -1 ? -1 : read(fd, got, max + 1);
+	if (fd != -1) close(fd);
+	if (n != (ssize_t)want_size || memcmp(got, want, want_size))
+		testFail(name, want_ret == 2 ? "file touched" : "file not rolled forward");
+
+done:
+	unlink(path);
+	unlink(journal);
+	free(old);
+	free(data);
+	free(want);
+	free(got);
+	if (failures == before) printf("ok   %s\n", name);
+}
+
+// a save whose journal can't be written (its name is too long) fails
+// without touching the file
+static void testJournalMissing() {
+	const char *name = "journal: can't be written";
+	char path[300];
+	int len = snprintf(path, sizeof(path), "/tmp/wasm-editor-test-%d-", (int)getpid());
+	memset(path + len, 'x', 250 - (len - strlen("/tmp/")));
+	strcpy(path + strlen("/tmp/") + 250, ".txt");
+	const char *text = "int x;\n";
+	int fd = testJournalFile(path, text, strlen(text));
+	if (fd == -1) {
+		testFail(name, "can't write the file");
+		return;
+	}
+	close(fd);
+
+	editorInit(&E, 24, 80);
+	int before = failures;
+	if (editorOpen(&E, path) != 0) {
+		testFail(name, "editorOpen");
+		goto done;
+	}
+	editorRowInsertChar(&E, &E.row[0], 0, 'u');
+	if (editorSave(&E) != -1) testFail(name, "editorSave didn't fail");
+	else if (strncmp(E.statusmsg, "Can't save!", strlen("Can't save!")))
+		testFail(name, "save: failure not reported");
+	if (!E.dirty) testFail(name, "save: not still marked modified");
+	char got[16];
+	fd = open(path, O_RDONLY);
+	ssize_t n = fd == -1 ? -1 : read(fd, got, sizeof(got));
+	if (fd != -1) close(fd);
+	if (n != (ssize_t)strlen(text) || memcmp(got, text, n)) testFail(name, "file touched");
+
+done:
+	editorFree(&E);
+	unlink(path);
+	if (failures == before) printf("ok   %s\n", name);
+}
+
+int main(int argc, char *argv[]) {
+	int shift = argc >= 2 && !strcmp(argv[1], "--small") ? TEST_SMALL_SHIFT : 0;
+
+	struct testFile sparse = {
+		.name = "sparse",
+		.head = "// large sparse file\nint head;\n",
+		.hole = 1,
+		.tail = "\nint tail; // " TEST_MARKER "\n",
+		.size = TEST_SPARSE_SIZE >> shift,
+		.marker_row = 3,
+		.rows = 4,
+	};
+	sparse.marker = sparse.size - strlen(sparse.tail) + strlen("\nint tail; // ");
+
+	struct testFile longline = {
+		.name = "long line",
+		.head = "// one long line\n",
+		.hole = 0,
+		.tail = " " TEST_MARKER "\nint tail;\n",
+		.size = TEST_LONG_SIZE >> shift,
+		.marker_row = 1,
+		.rows = 3,
+	};
+	longline.marker = longline.size - strlen(longline.tail) + 1;
+
+	snprintf(sparse.path, sizeof(sparse.path), "/tmp/wasm-editor-test-%d-sparse.txt", (int)getpid());
+	snprintf(longline.path, sizeof(longline.path), "/tmp/wasm-editor-test-%d-long.txt", (int)getpid());
+	testRoundTrip(&sparse);
+	testRoundTrip(&longline);
+
+	off_t size = TEST_JOURNAL_SIZE;
+	testJournal("journal: save not started", TEST_CUT_BEFORE, 100, size, size + 100);
+	testJournal("journal: save half done", TEST_CUT_BLOCKS, 5000, 6000, 11000);
+	testJournal("journal: save done but for the journal", TEST_CUT_UNLINK, 5000, 6000, 11000);
+	testJournal("journal: shrinking save half done", TEST_CUT_BLOCKS, 100, 9000, 9100);
+	testJournal("journal: file changed since", TEST_CUT_CHANGED, 5000, 6000, 11000);
+	testJournal("journal: file replaced since", TEST_CUT_REPLACED, 5000, 6000, 11000);
+	testJournalMissing();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+#include <pthread.h>
+#include <string.h>
+#include "utf8.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+size_t utf8AsciiPrefix(const char *s, size_t len) {
+	size_t i = 0;
+#ifdef __SSE2__
+	// the top bit of each byte, a set one ends the run
+	for (; i + 16 <= len; i += 16) {
+		int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(s + i)));
+		if (mask) return i + __builtin_ctz(mask);
+	}
+#else
+	for (; i + 8 <= len; i += 8) {
+		uint64_t v;
+		memcpy(&v, s + i, sizeof(v));
+		if (v & 0x8080808080808080ULL) break;
+	}
+#endif
+	while (i < len && !((unsigned char)s[i] & 0x80)) i++;
+	return i;
+}
+
+int utf8IsAscii(const char *s, size_t len) {
+	return utf8AsciiPrefix(s, len) == len;
+}
+
+size_t utf8Decode(const char *s, size_t len, uint32_t *cp) {
+	const unsigned char *u = (const unsigned char *)s;
+	*cp = UTF8_INVALID;
+	if (u[0] < 0x80) {
+		*cp = u[0];
+		return 1;
+	}
+
+	size_t n;
+	uint32_t c;
+	unsigned char lo = 0x80, hi = 0xBF; // range of the second byte
+	if (u[0] >= 0xC2 && u[0] <= 0xDF) {
+		n = 2;
+		c = u[0] & 0x1F;
+	} else if (u[0] >= 0xE0 && u[0] <= 0xEF) {
+		n = 3;
+		c = u[0] & 0x0F;
+		if (u[0] == 0xE0) lo = 0xA0; // overlong
+		if (u[0] == 0xED) hi = 0x9F; // surrogates
+	} else if (u[0] >= 0xF0 && u[0] <= 0xF4) {
+		n = 4;
+		c = u[0] & 0x07;
+		if (u[0] == 0xF0) lo = 0x90; // overlong
+		if (u[0] == 0xF4) hi = 0x8F; // past U+10FFFF
+	} else {
+		return 1;
+	}
+	if (len < n || u[1] < lo || u[1] > hi) return 1;
+	for (size_t k = 1; k < n; k++) {
+		if (!UTF8_CONT(u[k])) return 1;
+		c = c << 6 | (u[k] & 0x3F);
+	}
+	*cp = c;
+	return n;
+}
+
+/*** display width ***/
+
+struct utf8Range {
+	uint32_t first, last;
+};
+
+// combining marks and other code points that take no column
+static const struct utf8Range utf8_zero[] = {
+	{ 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+	{ 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+	{ 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+	{ 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0711, 0x0711 }, { 0x0730, 0x074A },
+	{ 0x07A6, 0x07B0 }, { 0x0900, 0x0902 }, { 0x093A, 0x093A }, { 0x093C, 0x093C },
+	{ 0x0941, 0x0948 }, { 0x094D, 0x094D }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 },
+	{ 0x0981, 0x0981 }, { 0x09BC, 0x09BC }, { 0x09C1, 0x09C4 }, { 0x09CD, 0x09CD },
+	{ 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x0EB1, 0x0EB1 },
+	{ 0x0EB4, 0x0EBC }, { 0x0EC8, 0x0ECD }, { 0x1160, 0x11FF }, { 0x1AB0, 0x1AFF },
+	{ 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x202A, 0x202E }, { 0x2060, 0x2064 },
+	{ 0x20D0, 0x20FF }, { 0x302A, 0x302D }, { 0x3099, 0x309A }, { 0xFE00, 0xFE0F },
+	{ 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }, { 0x1D167, 0x1D169 }, { 0x1D173, 0x1D182 },
+	{ 0xE0001, 0xE0001 }, { 0xE0020, 0xE007F }, { 0xE0100, 0xE01EF },
+};
+
+// east asian wide and fullwidth code points, and emoji
+static const struct utf8Range utf8_wide[] = {
+	{ 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC },
+	{ 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 },
+	{ 0x2648, 0x2653 }, { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+	{ 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26CE, 0x26CE },
+	{ 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+	{ 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+	{ 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+	{ 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF },
+	{ 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x3029 },
+	{ 0x302E, 0x303E }, { 0x3041, 0x3098 }, { 0x309B, 0x33FF }, { 0x3400, 0x4DBF },
+	{ 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF }, { 0xA960, 0xA97F }, { 0xAC00, 0xD7A3 },
+	{ 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE6F }, { 0xFF00, 0xFF60 },
+	{ 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x16FE4 }, { 0x17000, 0x18AFF }, { 0x1B000, 0x1B2FF },
+	{ 0x1F004, 0x1F004 }, { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E }, { 0x1F191, 0x1F19A },
+	{ 0x1F200, 0x1F251 }, { 0x1F300, 0x1F64F }, { 0x1F680, 0x1F6FF }, { 0x1F7E0, 0x1F7EB },
+	{ 0x1F90C, 0x1F9FF }, { 0x1FA70, 0x1FAFF }, { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD },
+};
+
+static int utf8InRanges(const struct utf8Range *r, size_t n, uint32_t cp) {
+	size_t lo = 0, hi = n;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (cp > r[mid].last) lo = mid + 1;
+		else if (cp < r[mid].first) hi = mid;
+		else return 1;
+	}
+	return 0;
+}
+
+static int utf8RangeWidth(uint32_t cp) {
+	if (utf8InRanges(utf8_zero, sizeof(utf8_zero) / sizeof(utf8_zero[0]), cp)) return 0;
+	if (utf8InRanges(utf8_wide, sizeof(utf8_wide) / sizeof(utf8_wide[0]), cp)) return 2;
+	return 1;
+}
+
+// widths of the BMP, 2 bits each
+static unsigned char utf8_bmp[0x10000 / 4];
+static pthread_once_t utf8_bmp_once = PTHREAD_ONCE_INIT;
+
+static void utf8BuildTable() {
+	for (uint32_t cp = 0; cp < 0x10000; cp++)
+		utf8_bmp[cp >> 2] |= utf8RangeWidth(cp) << ((cp & 3) * 2);
+}
+
+int utf8Width(uint32_t cp) {
+	if (cp < 0x300) return 1;
+	if (cp >= 0x10000) return utf8RangeWidth(cp);
+	pthread_once(&utf8_bmp_once, utf8BuildTable);
+	return (utf8_bmp[cp >> 2] >> ((cp & 3) * 2)) & 3;
+}
+
+/*** cursor steps ***/
+
+// the lead byte a continuation byte at i could belong to (i itself if
+// it isn't one)
+static size_t utf8Lead(const char *s, size_t i) {
+	size_t k = i;
+	while (k > 0 && i - k < 3 && UTF8_CONT(s[k])) k--;
+	return k;
+}
+
+size_t utf8Prev(const char *s, size_t len, size_t i) {
+	size_t k = utf8Lead(s, i - 1);
+	uint32_t cp;
+	if (k + utf8Decode(s + k, len - k, &cp) >= i) return k;
+	return i - 1;
+}
+
+size_t utf8Next(const char *s, size_t len, size_t i) {
+	uint32_t cp;
+	return i + utf8Decode(s + i, len - i, &cp);
+}
+
+size_t utf8Snap(const char *s, size_t len, size_t i) {
+	if (i >= len || !UTF8_CONT(s[i])) return i;
+	size_t k = utf8Lead(s, i);
+	uint32_t cp;
+	if (k + utf8Decode(s + k, len - k, &cp) > i) return k;
+	return i;
+}
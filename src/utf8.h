@@ -0,0 +1,44 @@
+#ifndef __UTF8_H__
+#define __UTF8_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// UTF-8 for the row layer: rows are bytes, but a code point takes 0, 1
+// or 2 columns and the cursor only stops at the start of one. A byte
+// that doesn't start a valid sequence (overlong, surrogate, truncated)
+// stands for itself and decodes as UTF8_INVALID, one column wide.
+// Pure ASCII text is spotted 16 bytes at a time (SSE2, 8 with plain
+// 64-bit words elsewhere) so it can skip all of this
+
+#define UTF8_INVALID 0xFFFD
+
+// is c a continuation byte (10xxxxxx)
+#define UTF8_CONT(c) (((unsigned char)(c) & 0xC0) == 0x80)
+
+// how many bytes s starts with are ASCII
+size_t utf8AsciiPrefix(const char *s, size_t len);
+
+// whether all len bytes of s are ASCII
+int utf8IsAscii(const char *s, size_t len);
+
+// decode the code point s (len > 0 bytes) starts with into *cp, returns
+// its length in bytes
+size_t utf8Decode(const char *s, size_t len, uint32_t *cp);
+
+// columns a code point takes on a terminal: 0 (combining marks), 1 or 2
+// (east asian wide and emoji). Control characters and UTF8_INVALID take
+// 1, they're drawn as a symbol. Looked up in a table for the BMP,
+// built the first time it's needed
+int utf8Width(uint32_t cp);
+
+// start of the code point before byte i (i > 0) of the len bytes of s
+size_t utf8Prev(const char *s, size_t len, size_t i);
+
+// start of the code point after the one at byte i (i < len)
+size_t utf8Next(const char *s, size_t len, size_t i);
+
+// start of the code point byte i is in
+size_t utf8Snap(const char *s, size_t len, size_t i);
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "vterm.h"
+#include "stats.h"
+
+struct vtermKey {
+	int key;
+	uint64_t at; // delivery time relative to the first read
+};
+
+static struct {
+	int active;
+	int rows, cols;
+	struct vtermKey *keys; // ring buffer of queued keys
+	size_t head, len, cap;
+	int paced;
+	uint64_t start; // clock at the first read, 0 before that
+	size_t bytes;
+	size_t frames;
+} V;
+
+void vtermEnable(int rows, int cols) {
+	V.active = 1;
+	V.rows = rows;
+	V.cols = cols;
+}
+
+int vtermActive() {
+	return V.active;
+}
+
+void vtermPushTimedKey(int key, uint64_t at) {
+	if (V.len == V.cap) {
+		size_t cap = V.cap ? V.cap * 2 : 64;
+		struct vtermKey *keys = malloc(sizeof(struct vtermKey) * cap);
+		if (keys == NULL) return;
+		// unwrap the ring into the new buffer
+		for (size_t i = 0; i < V.len; i++)
+			keys[i] = V.keys[(V.head + i) % V.cap];
+		free(V.keys);
+		V.keys = keys;
+		V.head = 0;
+		V.cap = cap;
+	}
+	struct vtermKey *k = &V.keys[(V.head + V.len) % V.cap];
+	k->key = key;
+	k->at = at;
+	V.len++;
+}
+
+void vtermPushKey(int key) {
+	vtermPushTimedKey(key, 0);
+}
+
+void vtermPushKeys(const char *s) {
+	while (*s) vtermPushKey((unsigned char)*s++);
+}
+
+void vtermSetPacing(int paced) {
+	V.paced = paced;
+}
+
+size_t vtermPending() {
+	return V.len;
+}
+
+int vtermReadKey() {
+	if (V.len == 0) return '\x1b';
+	struct vtermKey k = V.keys[V.head];
+	V.head = (V.head + 1) % V.cap;
+	V.len--;
+
+	uint64_t now = statsNow();
+	if (V.start == 0) V.start = now;
+	if (V.paced && V.start + k.at > now) {
+		// sleep until the key is due, as if the user was typing
+		uint64_t wait = V.start + k.at - now;
+		struct timespec ts = { wait / 1000000000ULL, wait % 1000000000ULL };
+		nanosleep(&ts, NULL);
+	}
+	return k.key;
+}
+
+void vtermWrite(const char *s, size_t len) {
+	(void)s;
+	V.bytes += len;
+	V.frames++;
+}
+
+size_t vtermBytesWritten() {
+	return V.bytes;
+}
+
+size_t vtermFramesWritten() {
+	return V.frames;
+}
+
+void vtermResetCounters() {
+	V.bytes = 0;
+	V.frames = 0;
+}
+
+void vtermGetWindowSize(int *rows, int *cols) {
+	*rows = V.rows;
+	*cols = V.cols;
+}
@@ -0,0 +1,52 @@
+#ifndef __VTERM_H__
+#define __VTERM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// an in-memory terminal that stands in for the tty: keys come from
+// a queue instead of stdin and output is counted instead of written
+// (used by the headless benchmark harness and session replay)
+
+// switch terminal i/o over to a virtual terminal of the given size
+void vtermEnable(int rows, int cols);
+
+// return 1 if the virtual terminal is in use
+int vtermActive();
+
+// queue a single key (may be one of the EDITOR_KEY constants)
+void vtermPushKey(int key);
+
+// queue a key that mustn't be delivered before at nanoseconds after the
+// first read (only honoured when pacing is on)
+void vtermPushTimedKey(int key, uint64_t at);
+
+// queue every byte of a string as a key
+void vtermPushKeys(const char *s);
+
+// deliver timed keys at their original pace (1) or as fast as possible (0)
+void vtermSetPacing(int paced);
+
+// number of keys still queued
+size_t vtermPending();
+
+// return the next queued key, or escape when the queue is empty
+// so prompts can't wait forever
+int vtermReadKey();
+
+// swallow output, keeping count of the bytes "written"
+void vtermWrite(const char *s, size_t len);
+
+// bytes written to the virtual terminal since the last reset
+size_t vtermBytesWritten();
+
+// number of frames written since the last reset
+size_t vtermFramesWritten();
+
+// zero the output counters
+void vtermResetCounters();
+
+// get the size of the virtual terminal
+void vtermGetWindowSize(int *rows, int *cols);
+
+#endif
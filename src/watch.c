@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "structs.h"
+#include "watch.h"
+#include "fileio.h"
+#include "output.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+
+void editorWatchStart(struct editorConfig *E) {
+	editorWatchStop(E);
+	if (E->filename == NULL) return;
+
+	char *dir = strdup(E->filename);
+	char *slash = strrchr(dir, '/');
+	const char *name = E->filename;
+	if (slash == NULL) {
+		strcpy(dir, ".");
+	} else {
+		name = E->filename + (slash - dir) + 1;
+		slash[slash == dir] = '\0'; // keep "/" for files in the root
+	}
+
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	// a writer that keeps the file open only ever modifies it
+	if (fd != -1 && inotify_add_watch(fd, dir,
+			IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1) {
+		close(fd);
+		fd = -1;
+	}
+	free(dir);
+	if (fd == -1) return;
+	E->watch.fd = fd;
+	E->watch.name = strdup(name);
+}
+
+void editorWatchStop(struct editorConfig *E) {
+	if (E->watch.fd != -1) close(E->watch.fd);
+	free(E->watch.name);
+	E->watch.fd = -1;
+	E->watch.name = NULL;
+}
+
+int editorWatchService(struct editorConfig *E) {
+	if (E->watch.fd == -1) return 0;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	int touched = 0;
+	ssize_t n;
+	while ((n = read(E->watch.fd, buf, sizeof(buf))) > 0) {
+		for (char *p = buf; p < buf + n; ) {
+			struct inotify_event *ev = (struct inotify_event *)p;
+			if ((ev->mask & IN_Q_OVERFLOW) ||
+					(ev->len && !strcmp(ev->name, E->watch.name))) touched = 1;
+			p += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+	// our own saves show up too, but leave the file as the rows have it
+	if (!touched || editorDiskChanged(E) != 1) return 0;
+
+	if (E->dirty) {
+		editorSetStatusMessage(E, "File changed on disk, keeping unsaved changes");
+		return 1;
+	}
+	if (editorReload(E) == -1) return 0;
+	return 1;
+}
+
+#else
+
+void editorWatchStart(struct editorConfig *E) {
+	(void)E;
+}
+
+void editorWatchStop(struct editorConfig *E) {
+	(void)E;
+}
+
+int editorWatchService(struct editorConfig *E) {
+	(void)E;
+	return 0;
+}
+
+#endif
+
+int editorWatchFd(struct editorConfig *E) {
+	return E->watch.fd;
+}
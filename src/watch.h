@@ -0,0 +1,26 @@
+#ifndef __WATCH_H__
+#define __WATCH_H__
+
+#include "structs.h"
+
+// notice when another process rewrites the open file (a log rotation, a
+// code generator) and reload it. The directory holding the file is
+// watched, so a file replaced by a rename is still seen. Only on linux
+// (inotify), elsewhere there's never anything to service. The front end
+// waits on editorWatchFd next to its input and calls editorWatchService
+// when it's readable
+
+// watch E->filename, replacing any previous watch (editorOpen does this)
+void editorWatchStart(struct editorConfig *E);
+
+// stop watching
+void editorWatchStop(struct editorConfig *E);
+
+// descriptor that becomes readable on a change, -1 if not watching
+int editorWatchFd(struct editorConfig *E);
+
+// handle pending changes: reload the file if it changed on disk and has
+// no unsaved changes. Returns 1 if the screen needs a repaint
+int editorWatchService(struct editorConfig *E);
+
+#endif
@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <string.h>
+#include "constants.h"
+#include "structs.h"
+#include "words.h"
+#include "cold.h"
+#include "memory.h"
+
+static int wordsIsIdent(unsigned char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+		c == '_' || c >= 0x80;
+}
+
+static int wordsIsDigit(unsigned char c) {
+	return c >= '0' && c <= '9';
+}
+
+// FNV-1a
+static uint32_t wordsHash(const char *s, size_t len) {
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		h ^= (unsigned char)s[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// the table slot holding a word, or the free one it would go in
+static uint32_t *wordsSlot(struct editorWords *w, const char *s, size_t len, uint32_t hash) {
+	for (size_t i = hash & w->mask; ; i = (i + 1) & w->mask) {
+		if (w->table[i] == 0) return &w->table[i];
+		struct wordEntry *e = &w->entries[w->table[i] - 1];
+		if (e->hash == hash && e->len == len && memcmp(w->text + e->at, s, len) == 0)
+			return &w->table[i];
+	}
+}
+
+// rebuild the table from the entries, size slots of it
+static void wordsRehash(struct editorWords *w, size_t size) {
+	memFree(w->table);
+	w->table = memAlloc(MEM_WORDS, sizeof(uint32_t) * size);
+	memset(w->table, 0, sizeof(uint32_t) * size);
+	w->mask = size - 1;
+	for (size_t k = 0; k < w->nentries; k++) {
+		struct wordEntry *e = &w->entries[k];
+		*wordsSlot(w, w->text + e->at, e->len, e->hash) = k + 1;
+	}
+}
+
+static void wordsAdd(struct editorWords *w, const char *s, size_t len, int delta) {
+	if (w->table == NULL) wordsRehash(w, 1024);
+	uint32_t hash = wordsHash(s, len);
+	uint32_t *slot = wordsSlot(w, s, len, hash);
+	if (*slot) {
+		struct wordEntry *e = &w->entries[*slot - 1];
+		if (delta > 0) {
+			if (e->count++ == 0) w->dead--;
+		} else if (e->count > 0) {
+			if (--e->count == 0) w->dead++;
+		}
+		return;
+	}
+	// the text is addressed with 32 bits
+	if (delta < 0 || w->len + len > UINT32_MAX) return;
+
+	if (w->len + len > w->cap) {
+		w->cap = w->cap ? w->cap * 2 : 4096;
+		if (w->cap < w->len + len) w->cap = w->len + len;
+		w->text = memRealloc(MEM_WORDS, w->text, w->cap);
+	}
+	if (w->nentries == w->capentries) {
+		w->capentries = w->capentries ? w->capentries * 2 : 256;
+		w->entries = memRealloc(MEM_WORDS, w->entries, sizeof(struct wordEntry) * w->capentries);
+	}
+	struct wordEntry *e = &w->entries[w->nentries];
+	e->at = w->len;
+	e->len = len;
+	e->hash = hash;
+	e->count = 1;
+	memcpy(w->text + w->len, s, len);
+	w->len += len;
+	*slot = ++w->nentries;
+	// at most half full
+	if (w->nentries * 2 > w->mask + 1) wordsRehash(w, (w->mask + 1) * 2);
+}
+
+static void wordsScan(struct editorWords *w, const char *chars, size_t size, int delta) {
+	size_t i = 0;
+	while (i < size) {
+		if (!wordsIsIdent(chars[i])) {
+			i++;
+			continue;
+		}
+		size_t j = i + 1;
+		while (j < size && wordsIsIdent(chars[j])) j++;
+		size_t len = j - i;
+		if (!wordsIsDigit(chars[i]) && len >= EDITOR_WORDS_MIN_LEN && len <= EDITOR_WORDS_MAX_LEN)
+			wordsAdd(w, &chars[i], len, delta);
+		i = j;
+	}
+}
+
+void editorWordsRow(struct editorConfig *E, erow *row, int delta) {
+	if (row->idx >= E->words.upto || row->size >= EDITOR_LONG_ROW) return;
+	wordsScan(&E->words, editorColdChars(E, row), row->size, delta);
+}
+
+void editorWordsMove(struct editorConfig *E, size_t at, size_t del, size_t count) {
+	struct editorWords *w = &E->words;
+	if (w->upto >= at + del) w->upto += count - del;
+	else if (w->upto > at) w->upto = at;
+}
+
+/*** sorting ***/
+
+static int wordsCompare(const struct editorWords *w, uint32_t a, uint32_t b) {
+	const struct wordEntry *x = &w->entries[a];
+	const struct wordEntry *y = &w->entries[b];
+	size_t n = x->len < y->len ? x->len : y->len;
+	int d = memcmp(w->text + x->at, w->text + y->at, n);
+	if (d) return d;
+	return x->len < y->len ? -1 : x->len > y->len;
+}
+
+// merge sort a[0..n) by word, tmp holding n more (qsort has no argument
+// to pass w through)
+static void wordsSort(const struct editorWords *w, uint32_t *a, uint32_t *tmp, size_t n) {
+	if (n < 2) return;
+	size_t half = n / 2;
+	wordsSort(w, a, tmp, half);
+	wordsSort(w, a + half, tmp, n - half);
+	size_t i = 0, j = half, k = 0;
+	while (i < half && j < n) tmp[k++] = wordsCompare(w, a[i], a[j]) <= 0 ? a[i++] : a[j++];
+	while (i < half) tmp[k++] = a[i++];
+	memcpy(a, tmp, sizeof(uint32_t) * k);
+}
+
+// drop the words that are gone (once they're most of the index), the
+// rest keeps its order
+static void wordsCompact(struct editorWords *w) {
+	size_t n = 0, len = 0;
+	for (size_t k = 0; k < w->nentries; k++) {
+		struct wordEntry e = w->entries[k];
+		if (e.count == 0) continue;
+		memmove(w->text + len, w->text + e.at, e.len);
+		e.at = len;
+		len += e.len;
+		w->entries[n++] = e;
+	}
+	w->nentries = n;
+	w->len = len;
+	w->dead = 0;
+	w->nsorted = 0;
+	size_t size = 1024;
+	while (n * 2 > size) size *= 2;
+	wordsRehash(w, size);
+}
+
+// sort the new words into the sorted array
+static void wordsMerge(struct editorWords *w) {
+	if (w->dead > EDITOR_WORDS_RECENT && w->dead * 2 > w->nentries) wordsCompact(w);
+	size_t n = w->nentries, old = w->nsorted;
+	if (n == old) return;
+
+	// the new words, then room to sort them in
+	uint32_t *fresh = malloc(sizeof(uint32_t) * (n - old) * 2);
+	for (size_t k = old; k < n; k++) fresh[k - old] = k;
+	wordsSort(w, fresh, fresh + (n - old), n - old);
+
+	uint32_t *sorted = memAlloc(MEM_WORDS, sizeof(uint32_t) * n);
+	size_t i = 0, j = 0, k = 0;
+	while (i < old && j < n - old)
+		sorted[k++] = wordsCompare(w, w->sorted[i], fresh[j]) <= 0 ? w->sorted[i++] : fresh[j++];
+	while (i < old) sorted[k++] = w->sorted[i++];
+	while (j < n - old) sorted[k++] = fresh[j++];
+	free(fresh);
+
+	memFree(w->sorted);
+	w->sorted = sorted;
+	w->nsorted = n;
+}
+
+/*** sweep and queries ***/
+
+int editorWordsSweep(struct editorConfig *E) {
+	struct editorWords *w = &E->words;
+	size_t budget = EDITOR_WORDS_SWEEP_ROWS;
+	for (; w->upto < E->numrows && budget > 0; w->upto++, budget--) {
+		erow *row = &E->row[w->upto];
+		if (row->size < EDITOR_LONG_ROW) wordsScan(w, editorColdChars(E, row), row->size, 1);
+	}
+	if (w->upto < E->numrows) return 1;
+	// every word is in, sort them while there's nothing else to do
+	if (w->nentries - w->nsorted > EDITOR_WORDS_RECENT) wordsMerge(w);
+	return 0;
+}
+
+int editorWordsPending(struct editorConfig *E) {
+	return E->words.upto < E->numrows;
+}
+
+size_t editorWordsStart(struct editorConfig *E, erow *row, size_t cx) {
+	const char *chars = editorColdChars(E, row);
+	size_t start = cx;
+	while (start > 0 && wordsIsIdent(chars[start - 1])) start--;
+	return start < cx && wordsIsDigit(chars[start]) ? cx : start;
+}
+
+// whether entry k is a live word longer than prefix that starts with it
+static int wordsMatch(struct editorWords *w, uint32_t k, const char *prefix, size_t len) {
+	struct wordEntry *e = &w->entries[k];
+	return e->count > 0 && e->len > len && memcmp(w->text + e->at, prefix, len) == 0;
+}
+
+size_t editorWordsComplete(struct editorConfig *E, const char *prefix, size_t len,
+		const char **words, size_t *lens, size_t max) {
+	struct editorWords *w = &E->words;
+	while (editorWordsSweep(E));
+	if (w->nentries - w->nsorted > EDITOR_WORDS_RECENT) wordsMerge(w);
+
+	// the first sorted word not before prefix
+	size_t lo = 0, hi = w->nsorted;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		struct wordEntry *e = &w->entries[w->sorted[mid]];
+		size_t n = e->len < len ? e->len : len;
+		int d = memcmp(w->text + e->at, prefix, n);
+		if (d < 0 || (d == 0 && e->len < len)) lo = mid + 1;
+		else hi = mid;
+	}
+
+	// up to max from the sorted words and every match among the new ones,
+	// the first max of all of them (with as much again to sort them in)
+	size_t cap = max + w->nentries - w->nsorted;
+	uint32_t *found = malloc(sizeof(uint32_t) * (cap ? cap * 2 : 1));
+	size_t n = 0;
+	for (size_t i = lo; i < w->nsorted && n < max; i++) {
+		struct wordEntry *e = &w->entries[w->sorted[i]];
+		if (e->len < len || memcmp(w->text + e->at, prefix, len) != 0) break;
+		if (wordsMatch(w, w->sorted[i], prefix, len)) found[n++] = w->sorted[i];
+	}
+	for (size_t k = w->nsorted; k < w->nentries; k++)
+		if (wordsMatch(w, k, prefix, len)) found[n++] = k;
+	wordsSort(w, found, found + cap, n);
+
+	if (n > max) n = max;
+	for (size_t i = 0; i < n; i++) {
+		words[i] = w->text + w->entries[found[i]].at;
+		lens[i] = w->entries[found[i]].len;
+	}
+	free(found);
+	return n;
+}
+
+void editorWordsReset(struct editorConfig *E) {
+	editorWordsFree(E);
+}
+
+void editorWordsFree(struct editorConfig *E) {
+	struct editorWords *w = &E->words;
+	memFree(w->text);
+	memFree(w->entries);
+	memFree(w->table);
+	memFree(w->sorted);
+	memset(w, 0, sizeof(*w));
+}
@@ -0,0 +1,47 @@
+#ifndef __WORDS_H__
+#define __WORDS_H__
+
+#include "structs.h"
+
+// identifier index for completion: every word (a run of letters, digits,
+// '_' and non-ASCII bytes not starting with a digit, a stricter cut than
+// is_separator) of the buffer with how often it occurs. Words live in a
+// hash table for updates and in a sorted array for prefix lookups, the
+// ones seen since it was last sorted in a short list looked through one
+// by one. The index covers rows [0, upto): the front end runs
+// editorWordsSweep while it's idle to extend it, and row changes keep it
+// up to date (a row's words go out before it changes and back in after,
+// inside an edit at editorCommitEdit). Long rows are left out
+
+// take a row's words out of the index (delta -1) or put them back (1),
+// nothing if the row isn't indexed
+void editorWordsRow(struct editorConfig *E, erow *row, int delta);
+
+// keep the indexed rows on the same rows when the del rows from at are
+// replaced by count new ones (their words already taken out, the new
+// ones' to be put in)
+void editorWordsMove(struct editorConfig *E, size_t at, size_t del, size_t count);
+
+// index some more rows, returns 1 if there's more to do
+int editorWordsSweep(struct editorConfig *E);
+
+// the sweep has work to do
+int editorWordsPending(struct editorConfig *E);
+
+// start of the word that ends at cx in a row (cx if there's none)
+size_t editorWordsStart(struct editorConfig *E, erow *row, size_t cx);
+
+// up to max words (in word order) longer than len that start with the
+// len bytes of prefix (not a cold row's chars), indexing what's left
+// first. The words aren't null terminated and stay valid until the
+// index next changes
+size_t editorWordsComplete(struct editorConfig *E, const char *prefix, size_t len,
+	const char **words, size_t *lens, size_t max);
+
+// forget every word, the sweep indexes the rows again
+void editorWordsReset(struct editorConfig *E);
+
+// free the index
+void editorWordsFree(struct editorConfig *E);
+
+#endif
@@ -0,0 +1,234 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "structs.h"
+#include "wrap.h"
+#include "row.h"
+#include "cold.h"
+#include "counts.h"
+#include "utf8.h"
+#include "output.h"
+
+// columns per visual line
+static size_t wrapWidth(struct editorConfig *E) {
+	return editorTextCols(E) > 0 ? (size_t)editorTextCols(E) : 1;
+}
+
+// every count may be stale. Once the generations run out the rows are
+// marked stale one by one to start over
+static void wrapNewGen(struct editorConfig *E) {
+	struct editorWrap *w = &E->wrap;
+	if (++w->gen == 0) {
+		for (size_t j = 0; j < E->numrows; j++) E->row[j].wrap_gen = 0;
+		w->gen = 1;
+	}
+}
+
+// a new screen width leaves every count stale
+static void wrapCheckWidth(struct editorConfig *E) {
+	if (E->wrap.cols == editorTextCols(E)) return;
+	E->wrap.cols = editorTextCols(E);
+	wrapNewGen(E);
+}
+
+// a place in a row that isn't all ASCII: render index, column, and the
+// visual line it's on with the column that line starts at
+struct wrapPos {
+	size_t at, col;
+	size_t line, start;
+};
+
+// walk a row that isn't all ASCII a code point at a time, breaking lines
+// where editorDrawRowUtf8 cuts them, up to render index at or the start
+// of visual line `line`, whichever comes first
+static struct wrapPos wrapWalk(erow *row, size_t width, size_t at, size_t line) {
+	struct wrapPos p = { 0, 0, 0, 0 };
+	while (p.at < row->rsize) {
+		uint32_t cp;
+		size_t n = utf8Decode(&row->render[p.at], row->rsize - p.at, &cp);
+		size_t w = utf8Width(cp);
+		// a code point that doesn't fit starts the next line
+		if (p.col + w > p.start + width && p.col > p.start) {
+			p.line++;
+			p.start = p.col;
+		}
+		if (p.at >= at || p.line >= line) return p;
+		p.col += w;
+		p.at += n;
+	}
+	// the end of a full line is on the next one
+	if (p.col >= p.start + width) {
+		p.line++;
+		p.start = p.col;
+	}
+	return p;
+}
+
+size_t editorWrapLines(struct editorConfig *E, erow *row) {
+	struct editorWrap *w = &E->wrap;
+	size_t old = countsGet(&w->lines, row->idx);
+	if (row->wrap_gen == w->gen) return old;
+	editorColdThaw(E, row);
+	size_t width = wrapWidth(E);
+	size_t n = row->ascii ? row->rsize / width + 1 : wrapWalk(row, width, SIZE_MAX, SIZE_MAX).line + 1;
+	if (n != old) countsAdd(&w->lines, row->idx, (ssize_t)n - (ssize_t)old);
+	row->wrap_gen = w->gen;
+	return n;
+}
+
+size_t editorWrapStart(struct editorConfig *E, erow *row, size_t line) {
+	size_t width = wrapWidth(E);
+	if (row->ascii) return line * width;
+	editorColdThaw(E, row);
+	return wrapWalk(row, width, SIZE_MAX, line).start;
+}
+
+// the visual line of a row cx is on, and its column in that line in *x
+static size_t wrapCursor(struct editorConfig *E, erow *row, size_t cx, size_t *x) {
+	size_t width = wrapWidth(E);
+	editorWrapLines(E, row);
+	editorColdThaw(E, row);
+	if (row->ascii) {
+		size_t rx = editorRowCxToRx(row, cx);
+		*x = rx % width;
+		return rx / width;
+	}
+	struct wrapPos p = wrapWalk(row, width, editorRowCxToRender(row, cx), SIZE_MAX);
+	*x = p.col - p.start;
+	return p.line;
+}
+
+// the cx at column x of a visual line of a row, or at the end of the
+// line if it's shorter
+static size_t wrapCx(struct editorConfig *E, erow *row, size_t line, size_t x) {
+	size_t width = wrapWidth(E);
+	if (row->ascii) {
+		size_t cx = editorRowRxToCx(row, line * width + x);
+		// a tab from the line before ends on this one, take the char after it
+		if (cx < row->size && editorRowCxToRx(row, cx) < line * width) cx++;
+		return cx;
+	}
+	struct wrapPos p = wrapWalk(row, width, SIZE_MAX, line);
+	size_t at = p.at, prev = p.at;
+	while (at < row->rsize) {
+		uint32_t cp;
+		size_t n = utf8Decode(&row->render[at], row->rsize - at, &cp);
+		size_t w = utf8Width(cp);
+		if (p.col + w > p.start + width) {
+			// the code point after the line's last one
+			if (at > p.at) at = prev;
+			break;
+		}
+		if (p.col + w > p.start + x) break;
+		p.col += w;
+		prev = at;
+		at += n;
+	}
+	size_t cx = editorRowRenderToCx(row, at);
+	if (cx < row->size && editorRowCxToRender(row, cx) < p.at) cx = editorRowNextCx(E, row, cx);
+	return editorRowSnapCx(E, row, cx);
+}
+
+// the visual line the cursor is on, counted from the top of the buffer
+static size_t wrapCursorLine(struct editorConfig *E, size_t line) {
+	return countsPrefix(&E->wrap.lines, E->cy) + line;
+}
+
+void editorWrapToggle(struct editorConfig *E) {
+	struct editorWrap *w = &E->wrap;
+	w->on = !w->on;
+	countsFree(&w->lines);
+	if (!w->on) return;
+	// every row takes a line until it's wrapped
+	for (size_t j = 0; j < E->numrows; j++) countsInsert(&w->lines, j, 1);
+	w->cols = editorTextCols(E);
+	wrapNewGen(E);
+	w->lineoff = 0;
+	E->coloff = 0;
+}
+
+void editorWrapMove(struct editorConfig *E, size_t at, size_t del, size_t count) {
+	struct editorWrap *w = &E->wrap;
+	if (!w->on) return;
+	if (del == 0 && count == 1) {
+		countsInsert(&w->lines, at, 1);
+	} else if (del == 1 && count == 0) {
+		countsDelete(&w->lines, at);
+	} else {
+		size_t *ones = malloc(sizeof(size_t) * (count ? count : 1));
+		for (size_t j = 0; j < count; j++) ones[j] = 1;
+		countsReplace(&w->lines, at, del, ones, count);
+		free(ones);
+	}
+}
+
+void editorWrapScroll(struct editorConfig *E) {
+	struct editorWrap *w = &E->wrap;
+	wrapCheckWidth(E);
+	E->coloff = 0;
+	size_t line = 0, x = 0;
+	if (E->cy < E->numrows) line = wrapCursor(E, &E->row[E->cy], E->cx, &x);
+	if (E->rowoff >= E->numrows) w->lineoff = 0;
+	else if (w->lineoff >= editorWrapLines(E, &E->row[E->rowoff])) w->lineoff = 0;
+
+	if (E->cy < E->rowoff || (E->cy == E->rowoff && line < w->lineoff)) {
+		E->rowoff = E->cy;
+		w->lineoff = line;
+	} else {
+		// fresh counts for the rows on screen, so the cursor is drawn
+		// where they say it is
+		size_t lines = 0, screen = E->screenrows > 0 ? E->screenrows : 1;
+		for (size_t j = E->rowoff; j < E->numrows && lines < screen + w->lineoff; j++)
+			lines += editorWrapLines(E, &E->row[j]);
+		size_t top = countsPrefix(&w->lines, E->rowoff) + w->lineoff;
+		size_t v = wrapCursorLine(E, line);
+		if (v >= top + screen) {
+			// and for the screen ending at the cursor
+			lines = line + 1;
+			for (size_t j = E->cy; j-- > 0 && lines < screen; )
+				lines += editorWrapLines(E, &E->row[j]);
+			v = wrapCursorLine(E, line);
+			top = v + 1 - screen;
+			E->rowoff = countsSearch(&w->lines, top);
+			w->lineoff = top - countsPrefix(&w->lines, E->rowoff);
+		}
+	}
+	w->y = wrapCursorLine(E, line) - (countsPrefix(&w->lines, E->rowoff) + w->lineoff);
+	w->x = x;
+}
+
+void editorWrapMoveLines(struct editorConfig *E, ssize_t delta) {
+	struct editorWrap *w = &E->wrap;
+	wrapCheckWidth(E);
+	size_t line = 0, x = 0;
+	if (E->cy < E->numrows) line = wrapCursor(E, &E->row[E->cy], E->cx, &x);
+
+	// fresh counts for the rows moved over
+	size_t lines = 0;
+	if (delta > 0) {
+		if (E->cy < E->numrows) lines = editorWrapLines(E, &E->row[E->cy]) - line - 1;
+		for (size_t j = E->cy + 1; j < E->numrows && lines < (size_t)delta; j++)
+			lines += editorWrapLines(E, &E->row[j]);
+	} else {
+		lines = line;
+		for (size_t j = E->cy; j-- > 0 && lines < (size_t)-delta; )
+			lines += editorWrapLines(E, &E->row[j]);
+	}
+
+	// the line after the last row is the cursor's too
+	size_t v = wrapCursorLine(E, line), last = countsPrefix(&w->lines, E->numrows);
+	size_t target = delta < 0 && (size_t)-delta > v ? 0 : v + delta;
+	if (target > last) target = last;
+	E->cy = countsSearch(&w->lines, target);
+	E->cx = 0;
+	if (E->cy < E->numrows) {
+		erow *row = &E->row[E->cy];
+		editorColdThaw(E, row);
+		E->cx = wrapCx(E, row, target - countsPrefix(&w->lines, E->cy), x);
+	}
+}
+
+void editorWrapFree(struct editorConfig *E) {
+	countsFree(&E->wrap.lines);
+	memset(&E->wrap, 0, sizeof(E->wrap));
+}
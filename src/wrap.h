@@ -0,0 +1,43 @@
+#ifndef __WRAP_H__
+#define __WRAP_H__
+
+#include <sys/types.h>
+#include "structs.h"
+
+// soft wrap: with it on, a row is drawn over as many screen lines
+// (visual lines) as it takes at the screen's width, breaking before the
+// code point that doesn't fit, and the view scrolls by visual lines
+// instead of coloff. A row always has room for the cursor after its last
+// column, so one that fills its last line exactly gets an empty one.
+// Each row's count of visual lines is kept in a counted B-tree, so finding
+// the row a visual line is on is O(log n). Counts are worked out as rows
+// are drawn or moved over: a changed row or a new screen width only
+// leaves the counts stale (see struct editorWrap), and rows far away
+// keep theirs until they're next on screen
+
+// turn soft wrap on or off
+void editorWrapToggle(struct editorConfig *E);
+
+// keep the counts on the same rows when the del rows from at are
+// replaced by count new ones
+void editorWrapMove(struct editorConfig *E, size_t at, size_t del, size_t count);
+
+// visual lines of a row at the current width, wrapping it again if its
+// count is stale
+size_t editorWrapLines(struct editorConfig *E, erow *row);
+
+// the column visual line `line` of a row starts at
+size_t editorWrapStart(struct editorConfig *E, erow *row, size_t line);
+
+// editorScroll in soft wrap mode: scroll the view (rowoff and lineoff)
+// so the cursor's visual line is on screen and note where it's drawn
+void editorWrapScroll(struct editorConfig *E);
+
+// move the cursor delta visual lines down (up if negative), keeping its
+// column on screen where the line is long enough
+void editorWrapMoveLines(struct editorConfig *E, ssize_t delta);
+
+// free the layout
+void editorWrapFree(struct editorConfig *E);
+
+#endif